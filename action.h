@@ -24,24 +24,13 @@ public:
 	class white; // create a placing action of white with position
 
 public:
-	virtual board::reward apply(board& b) const {
-		auto proto = entries().find(type());
-		if (proto != entries().end()) return proto->second->reinterpret(this).apply(b);
-		return -1;
-	}
-	virtual std::ostream& operator >>(std::ostream& out) const {
-		auto proto = entries().find(type());
-		if (proto != entries().end()) return proto->second->reinterpret(this) >> out;
-		return out << "??";
-	}
-	virtual std::istream& operator <<(std::istream& in) {
-		auto state = in.rdstate();
-		for (auto proto = entries().begin(); proto != entries().end(); proto++) {
-			if (proto->second->reinterpret(this) << in) return in;
-			in.clear(state);
-		}
-		return in.ignore(2);
-	}
+	/**
+	 * the placing actions (of the types place, black, and white) are handled in place by a switch on the type,
+	 * and only the other types are dispatched to their prototypes in entries()
+	 */
+	virtual board::reward apply(board& b) const;
+	virtual std::ostream& operator >>(std::ostream& out) const;
+	virtual std::istream& operator <<(std::istream& in);
 
 public:
 	operator unsigned() const { return code; }
@@ -70,12 +59,12 @@ public:
 	board::point position() const { return board::point(int16_t(event() & 0xffff)); }
 	board::piece_type color() const { return static_cast<board::piece_type>(event() >> 16); }
 public:
-	board::reward apply(board& b) const { return b.place(position(), color()); }
-	std::ostream& operator >>(std::ostream& out) const {
+	board::reward apply(board& b) const final { return b.place(position(), color()); }
+	std::ostream& operator >>(std::ostream& out) const final {
 		return out << ';' << "?BW?"[color() & 0b11] << '[' << char('a' + position().x)
 		           << char('a' + ((board::size_y - 1) - position().y)) << ']';
 	}
-	std::istream& operator <<(std::istream& in) {
+	std::istream& operator <<(std::istream& in) final {
 		while (isspace(in.peek()) && in.ignore(1));
 		char buf[8];
 		if (in.peek() == ';' && in.read(buf, 6)) { // ;B[aa]
@@ -118,3 +107,43 @@ protected:
 	action& reinterpret(const action* a) const { return *new (const_cast<action*>(a)) white(*a); }
 	static __attribute__((constructor)) void init() { entries()[type_flag('W')] = new white; }
 };
+
+inline board::reward action::apply(board& b) const {
+	switch (type()) {
+	case action::place::type:
+	case action::black::type:
+	case action::white::type:
+		return action::place(*this).apply(b);
+	}
+	auto proto = entries().find(type());
+	if (proto != entries().end()) return proto->second->reinterpret(this).apply(b);
+	return -1;
+}
+
+inline std::ostream& action::operator >>(std::ostream& out) const {
+	switch (type()) {
+	case action::place::type:
+	case action::black::type:
+	case action::white::type:
+		return action::place(*this) >> out;
+	}
+	auto proto = entries().find(type());
+	if (proto != entries().end()) return proto->second->reinterpret(this) >> out;
+	return out << "??";
+}
+
+inline std::istream& action::operator <<(std::istream& in) {
+	auto state = in.rdstate();
+	action::place mv;
+	if (mv << in) {
+		code = mv.code;
+		return in;
+	}
+	in.clear(state);
+	for (auto proto = entries().begin(); proto != entries().end(); proto++) {
+		if (proto->first == action::place::type || proto->first == action::black::type || proto->first == action::white::type) continue;
+		if (proto->second->reinterpret(this) << in) return in;
+		in.clear(state);
+	}
+	return in.ignore(2);
+}
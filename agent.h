@@ -17,63 +17,35 @@
 #include <fstream>
 #include <queue>
 #include <cfloat>
+#include <climits>
+#include <chrono>
+#include <thread>
+#include <numeric>
+#include <memory>
+#include <mutex>
+#include <functional>
 #include "board.h"
 #include "action.h"
+#include "mcts.h"
+#include "solver.h"
+#include "book.h"
 
 using namespace std;
-class Node
-{
-public:
-	Node() {}
-	Node *parent = nullptr;
-	vector<Node *> children;
-	int win = 0, games = 0;
-	board state;
-	action::place move;
-	board::piece_type placer = board::black;
 
-public:
-	bool isleaf()
-	{
-		if (children.size() == 0)
-		{
-			return true;
-		}
-		return false;
-	}
-	float UCTvalue()
-	{
-		// the case that the node is unvisited
-		if (games == 0)
-		{
-			return DBL_MAX;
-		}
-		// common case
-		float c = sqrt(2);
-		return (float)win / games + c * sqrt(log(parent->win) / games);
-	}
-	int legal_count()
-	{
-		vector<action::place> legalmoves;
-		for (size_t i = 0; i < board::size_x * board::size_y; i++)
-		{
-			board after = state;
-			action::place move(i, state.info().who_take_turns);
-			if (move.apply(after) == board::legal)
-			{
-				legalmoves.emplace_back(action::place(i, state.info().who_take_turns));
-			}
-		}
-		return legalmoves.size();
-	}
-	action::place GetBestMove() const
-	{
-		vector<Node *> sortedChildNodes(children);
-		sort(begin(sortedChildNodes), end(sortedChildNodes), [](Node *x, Node *y)
-			 { return x->games > y->games; });
-		return sortedChildNodes[0]->move;
-	}
+/**
+ * the counters of the search behind a move, e.g., for the statistics and the comments of the records
+ * all zero if the move was not searched
+ */
+struct search_counters
+{
+	uint32_t iterations = 0;
+	uint32_t playouts = 0;
+	uint32_t nodes = 0; // the nodes in the trees after the search
+	uint32_t depth = 0; // the maximum depth of the selections
+	uint64_t memory = 0; // the bytes of the trees and the table
+	explicit operator bool() const { return iterations || playouts || nodes; }
 };
+
 class agent
 {
 public:
@@ -92,6 +64,10 @@ public:
 	virtual void close_episode(const std::string &flag = "") {}
 	virtual action take_action(const board &b) { return action(); }
 	virtual bool check_for_win(const board &b) { return false; }
+	virtual void ponder(const board &b) {}
+	virtual void stop_pondering() {}
+	virtual search_counters counters() const { return {}; }
+	virtual void interrupt() {}
 
 public:
 	virtual std::string property(const std::string &key) const { return meta.at(key); }
@@ -153,10 +129,11 @@ public:
 	virtual action take_action(const board &state)
 	{
 		std::shuffle(space.begin(), space.end(), engine);
+		if (state.info().who_take_turns != who)
+			return action();
 		for (const action::place &move : space)
 		{
-			board after = state;
-			if (move.apply(after) == board::legal)
+			if (state.check_place(move.position().x, move.position().y, who) == board::legal)
 				return move;
 		}
 		return action();
@@ -167,11 +144,24 @@ private:
 	board::piece_type who;
 };
 
+/**
+ * the helpers of a search on other processes, e.g., the workers of a coordinator, see remote.h
+ * start() is called with the arguments of the player right before its own search, and collect() adds the statistics
+ * of the root children of the helpers (of the side to move) after the search, and returns their iterations
+ */
+class search_helpers
+{
+public:
+	virtual ~search_helpers() {}
+	virtual void start(const board &state, const std::string &args, int iterations, int budget_ms) = 0;
+	virtual size_t collect(std::array<int, board::size_x * board::size_y> &win, std::array<int, board::size_x * board::size_y> &games) = 0;
+};
+
 class MCTSplayer : public random_agent
 {
 public:
 	MCTSplayer(const std::string &args = "") : random_agent("name=random role=unknown " + args),
-											   space(board::size_x * board::size_y), who(board::empty)
+											   who(board::empty), arguments(args)
 	{
 		if (name().find_first_of("[]():; ") != std::string::npos)
 			throw std::invalid_argument("invalid name: " + name());
@@ -181,184 +171,634 @@ public:
 			who = board::white;
 		if (who == board::empty)
 			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++)
-			space[i] = action::place(i, who);
 		if (meta.find("mcts") != meta.end())
 			std::cout << "mcts player init" << std::endl;
 		if (meta.find("T") != meta.end())
 			simulation_time = meta["T"];
+		if (meta.find("timeout") != meta.end())
+			budget_ms = meta["timeout"];
+		if (meta.find("budget_ms") != meta.end())
+			budget_ms = meta["budget_ms"];
+		if (meta.find("game_time") != meta.end())
+			game_time = meta["game_time"];
+		if (meta.find("threads") != meta.end())
+			threads = std::max(int(meta["threads"]), 1);
+		if (meta.find("parallel") != meta.end())
+			tree_parallel = (meta["parallel"].value == "tree");
+		if (meta.find("nodes") != meta.end())
+			node_limit = meta["nodes"];
+		if (meta.find("reuse") != meta.end())
+			reuse = int(meta["reuse"]);
+		if (meta.find("ponder") != meta.end())
+			pondering = int(meta["ponder"]);
+		reuse = reuse || pondering; // the pondered subtrees are useless without reusing them
+		if (meta.find("batch") != meta.end())
+			batch = std::max(1, std::min(int(meta["batch"]), int(batch_playout::lanes)));
+		if (meta.find("sym") != meta.end())
+			symmetric = int(meta["sym"]);
+		if (meta.find("rave") != meta.end() && int(meta["rave"]))
+			rave = meta.find("rave_k") != meta.end() ? float(meta["rave_k"]) : 300;
+		if (meta.find("widen") != meta.end())
+			widen = std::max(int(meta["widen"]), 0);
+		if (meta.find("eval") != meta.end())
+		{
+			// the leaves of all the threads are gathered into the batches of the evaluator
+			size_t eval_batch = meta.find("eval_batch") != meta.end() ? std::max(int(meta["eval_batch"]), 1) : threads;
+			int eval_wait = meta.find("eval_wait") != meta.end() ? int(meta["eval_wait"]) : 1000;
+			std::string model = meta.find("model") != meta.end() ? std::string(meta["model"]) : "";
+			network.reset(new batch_evaluator(evaluator::create(meta["eval"], model), eval_batch, std::chrono::microseconds(eval_wait)));
+		}
+		if (meta.find("book") != meta.end())
+		{
+			book.reset(new opening_book(meta["book"]));
+			book_min = meta.find("book_min") != meta.end() ? std::max(int(meta["book_min"]), 1) : 16;
+		}
+		if (meta.find("search") != meta.end())
+			alphabeta = (meta["search"].value == "alpha-beta");
+		if (meta.find("depth") != meta.end())
+			depth = std::max(int(meta["depth"]), 1);
+		if (meta.find("solve") != meta.end())
+			solve = std::max(int(meta["solve"]), 0);
+		if (meta.find("solve_nodes") != meta.end())
+			solve_nodes = std::max(int(meta["solve_nodes"]), 1);
+		if (meta.find("solve_leaf") != meta.end())
+			solve_leaf = std::max(int(meta["solve_leaf"]), 0);
+		if (alphabeta || solve)
+			solvers = std::vector<Solver>(threads, Solver(meta.find("solve_bits") != meta.end() ? int(meta["solve_bits"]) : 16));
+		if (meta.find("tt") != meta.end() && int(meta["tt"]))
+			table.reset(new TranspositionTable(meta.find("tt_bits") != meta.end() ? int(meta["tt_bits"]) : 20));
+		// each thread of root parallelism searches its own tree, and each thread has its own playout engine
+		trees = std::vector<NodePool>(tree_parallel ? 1 : threads);
+		unsigned seed = meta.find("seed") != meta.end() ? unsigned(int(meta["seed"])) : std::default_random_engine::default_seed;
+		for (int k = 0; k < threads; k++)
+			playouts.emplace_back(seed + k);
+	}
+	virtual ~MCTSplayer() { stop_pondering(); }
+
+	/**
+	 * restart the random numbers of the player and of its playout engines, as the seed option does
+	 */
+	void seed(unsigned seed)
+	{
+		engine.seed(seed);
+		for (size_t k = 0; k < playouts.size(); k++)
+			playouts[k].engine().seed(seed + k);
+	}
+
+	virtual void open_episode(const std::string &flag = "")
+	{
+		stop_pondering();
+		time_left = game_time;
+		if (table)
+			table->clear();
+		for (Solver &solver : solvers)
+			solver.clear();
+		lost = false;
+		last_move = -1;
 	}
-	virtual ~MCTSplayer() {}
 
 public:
+	/**
+	 * the wall-clock budget (ms) of the next move, or 0 if the search is bounded by simulation_time
+	 * with game_time, the remaining time of the game is spread over the expected remaining moves,
+	 * which is estimated as half of the current legal moves; budget_ms still caps each move
+	 */
+	int move_budget(const board &state) const
+	{
+		if (game_time == 0)
+			return budget_ms;
+		int expected = std::max(int(state.legal_moves(who).count() / 2), 4);
+		int budget = std::max(time_left / expected, 1);
+		return budget_ms ? std::min(budget, budget_ms) : budget;
+	}
+
 	virtual action take_action(const board &state)
 	{
-		root = new Node();
-		Node *current_node;
-		// decide the placer of root
-		if (who == board::black)
+		stop_pondering();
+		// the moves in the book are played without any search, which leaves more of game_time to the later moves
+		int known = book ? book->lookup(state, book_min) : -1;
+		if (known != -1)
 		{
-			root->placer = board::white;
+			last_iterations = 0;
+			last_depth = 0;
+			last_solved = 0;
+			last_visits = {};
+			last_move = -1; // nothing to reuse or ponder
+			return action::place(known, who);
 		}
-		else
+		auto start = std::chrono::steady_clock::now();
+		int budget = move_budget(state);
+		auto deadline = start + std::chrono::milliseconds(budget);
+		// the alpha-beta search plays its best move, and a won endgame is played by the solver without MCTS,
+		// where the solver takes at most half of the budget, and MCTS searches for the rest if the game is not won
+		// a game proven lost is searched without the proofs, so that the moves still test the opponent
+		int solved = -1;
+		lost = false;
+		if (alphabeta)
 		{
-			root->placer = board::black;
+			solved = solve_move(state, depth, SIZE_MAX, budget ? &deadline : nullptr);
 		}
-
-		for (int i = 0; i < simulation_time; i++)
+		else if (solve && int(state.legal_moves(who).count()) <= solve)
+		{
+			auto half = start + std::chrono::milliseconds(budget) / 2;
+			solved = solve_move(state, INT_MAX, solve_nodes, budget ? &half : nullptr);
+		}
+		if (solved != -1 || alphabeta)
 		{
-			board current_board(state);
-			// select
-			current_node = selection(current_board, root);
-			// expand
-			if (current_node->games != 0)
+			if (game_time)
 			{
-				expansion(current_board, current_node);
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				time_left = std::max(time_left - int(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()), 0);
 			}
-			// simulate
-			bool win = simulation(current_board);
-			// backpropagation
-			backpropagation(current_node, win);
+			return solved != -1 ? action(action::place(solved, who)) : action();
+		}
+		action move = search(state, budget ? INT_MAX : simulation_time, budget ? &deadline : nullptr);
+		if (game_time)
+		{
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			time_left -= std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+			time_left = std::max(time_left, 0);
+		}
+		return move;
+	}
+
+	/**
+	 * search the state by the solver to the given depth within the budget of nodes (and the deadline if given),
+	 * and keep its counters, return the best move, or -1 if the search to the end of the game (INT_MAX) does not prove a win
+	 */
+	int solve_move(const board &state, int plies, size_t budget, const std::chrono::steady_clock::time_point *deadline = nullptr)
+	{
+		board current(state);
+		int best = -1;
+		int value = solvers[0].search(current, plies, budget, &best, deadline);
+		lost = plies == INT_MAX && value <= -Solver::win;
+		if (plies == INT_MAX && value < Solver::win)
+			return -1;
+		last_iterations = 0;
+		last_depth = solvers[0].depth();
+		last_solved = solvers[0].nodes();
+		last_visits = {};
+		last_move = -1; // nothing to reuse or ponder
+		return best;
+	}
+
+	/**
+	 * run at most the given iterations of MCTS in total, or until the deadline if given
+	 * with multiple threads, either each thread searches an independent tree and the statistics
+	 * of the root children are merged (root parallelism), or all threads search a single tree (tree parallelism)
+	 */
+	action search(const board &state, int iterations, const std::chrono::steady_clock::time_point *deadline = nullptr)
+	{
+		SearchLimit limit(iterations, deadline);
+		prepare(state, deadline ? node_limit : size_t(iterations) * board::size_x * board::size_y);
+		if (helpers)
+		{
+			auto left = deadline ? std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now()) : std::chrono::milliseconds(0);
+			helpers->start(state, arguments, iterations, deadline ? std::max(int(left.count()), 1) : 0);
 		}
-		Node *best_node = selectbestchild(root);
-		action::place best_move;
+		activate(&limit);
+		last_iterations = run_workers(state, roots, limit, &last_depth);
+		last_solved = 0;
+		activate(nullptr);
+
+		// pick the root child with the best win rate, summed over the trees (and the helpers)
+		std::array<int, board::size_x * board::size_y> win = {}, games = {};
+		size_t order = merge_roots(win, games);
+		if (helpers)
+			last_iterations += helpers->collect(win, games);
+		int best_move = selectbestchild(trees[order], roots[order], win, games);
+		if (solve && !lost)
+			best_move = proven_move(trees[order], roots[order], games, best_move);
+		last_visits = games;
+		last_wins = win;
+		last_state = state;
+		last_move = best_move;
 		// if not null
-		if (best_node)
+		if (best_move != -1)
 		{
-			best_move = best_node->move;
-			delete root;
-			return best_move;
+			return action::place(best_move, who);
 		}
 		else
 		{
-			delete root;
 			return action();
 		}
 	}
 
-public:
-	Node *selection(board &state, Node *root)
+	/**
+	 * a root child of an analysis, with its visits (playouts), its win rate, and its principal variation
+	 */
+	struct analysis
+	{
+		int move;
+		int visits;
+		float winrate; // of who
+		std::vector<int> pv; // from the move, following the most visited children
+	};
+
+	/**
+	 * search the state without any budget until keep() returns false or the search is interrupted,
+	 * and report the root children sorted by their visits after every interval (ms) of the search
+	 */
+	void analyze(const board &state, int interval, std::function<bool()> keep, std::function<void(const std::vector<analysis> &)> report)
 	{
-		// selection
-		Node *node = root;
-		while (!node->isleaf())
+		stop_pondering();
+		prepare(state, node_limit);
+		last_move = -1; // the trees are not kept for the next move
+		while (true)
 		{
-			node = selectchild(state, node);
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(interval, 1));
+			SearchLimit limit(INT_MAX, &deadline);
+			activate(&limit);
+			bool stopped = !keep(); // checked after activate(), so that an interrupt() after keep() is not missed
+			if (!stopped)
+				last_iterations = run_workers(state, roots, limit, &last_depth);
+			activate(nullptr);
+			// the search of a proven root returns at once, so wait for the rest of the interval
+			while (root_proven() && keep() && std::chrono::steady_clock::now() < deadline)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			if (stopped || !keep())
+				break;
+			report(analyses());
 		}
-		return node;
 	}
-	void expansion(board &state, Node *node)
+
+	/**
+	 * stop the running search if any, e.g., from another thread, the search returns the best move so far
+	 */
+	virtual void interrupt()
 	{
-		// expansion
-		// expand in random order
-		shuffle(space.begin(), space.end(), engine);
-		for (action::place &move : space)
+		std::lock_guard<std::mutex> guard(active_mutex);
+		if (active)
+			active->stop();
+	}
+
+private:
+	/**
+	 * keep the subtrees of the current state if possible, otherwise release the previous trees and create the roots
+	 * with tree parallelism, the shared tree reserves the given nodes in advance
+	 * every tree is limited to node_limit nodes, which also bounds the searches without a budget, e.g., ponder() and analyze()
+	 */
+	void prepare(const board &state, size_t reserve)
+	{
+		int reply = reuse ? opponent_reply(state) : -1;
+		roots.resize(trees.size());
+		for (size_t t = 0; t < trees.size(); t++)
 		{
-			Node *newnode = new Node();
-			board after = state;
-			// if the move is legal, add child to the node
-			if (after.place(move.position()) == board::legal)
+			NodePool &tree = trees[t];
+			tree.set_limit(node_limit);
+			int node = reply != -1 ? find_child(tree, find_child(tree, roots[t], last_move), reply) : -1;
+			if (node != -1)
 			{
-				newnode->move = move;
-				newnode->parent = node;
-				if (node->placer == board::black)
-					newnode->placer = board::white;
-				else
-					newnode->placer = board::black;
-				node->children.emplace_back(newnode);
+				roots[t] = tree.retain(node);
 			}
+			else
+			{
+				tree.clear();
+				roots[t] = MCTS::create_root(tree, who, state, symmetric);
+			}
+			if (tree_parallel && threads > 1)
+				tree.reserve(tree.size() + reserve);
 		}
 	}
-	bool simulation(board &state)
+
+	/**
+	 * whether the root of any tree is proven, which stops the searches of all the trees
+	 */
+	bool root_proven() const
+	{
+		for (size_t t = 0; t < trees.size(); t++)
+			if (trees[t][roots[t]].solved())
+				return true;
+		return false;
+	}
+
+	/**
+	 * sum the statistics of the root children over the trees,
+	 * return the first tree with an expanded root, which gives the order of the children
+	 */
+	size_t merge_roots(std::array<int, board::size_x * board::size_y> &win, std::array<int, board::size_x * board::size_y> &games) const
 	{
-		// simulation
-		board current_board(state);
-		while (!is_terminal(current_board))
+		for (size_t t = 0; t < trees.size(); t++)
 		{
-			std::shuffle(space.begin(), space.end(), engine);
-			for (const action::place &move : space)
+			const Node &root = trees[t][roots[t]];
+			for (int child = root.first_child; child < root.first_child + root.child_count; child++)
 			{
-				board after(current_board);
-				if (after.place(move.position()) == board::legal)
-				{
-					current_board.place(move.position());
-				}
+				win[trees[t][child].position] += trees[t][child].win;
+				games[trees[t][child].position] += trees[t][child].games;
 			}
 		}
-		board::piece_type w = current_board.get_who_take_turn();
-		if (w == who)
-			return 0;
-		else
-			return 1;
+		// the first tree with an expanded root gives the order of the children, since the other threads
+		// may have taken all the iterations before the caller's own tree got expanded
+		size_t order = 0;
+		while (order + 1 < trees.size() && trees[order][roots[order]].child_count <= 0)
+			order++;
+		return order;
 	}
-	void backpropagation(Node *node, bool win)
+
+	/**
+	 * the root children of the trees after a search, sorted by their visits
+	 * the principal variations are taken from the tree giving the order, see merge_roots()
+	 */
+	std::vector<analysis> analyses() const
 	{
-		while (node != nullptr)
+		std::array<int, board::size_x * board::size_y> win = {}, games = {};
+		size_t order = merge_roots(win, games);
+		const NodePool &tree = trees[order];
+		std::vector<analysis> moves;
+		const Node &root = tree[roots[order]];
+		for (int child = root.first_child; child < root.first_child + root.child_count; child++)
 		{
-			node->games++;
-			if (win)
-				node->win++;
-			node = node->parent;
+			int position = tree[child].position;
+			if (!games[position])
+				continue;
+			analysis a = {position, games[position], float(win[position]) / games[position], {}};
+			for (int node = child; node != -1 && tree[node].games > 0 && a.pv.size() < max_pv;)
+			{
+				a.pv.push_back(tree[node].position);
+				int next = -1;
+				for (int c = tree[node].first_child; c < tree[node].first_child + tree[node].child_count; c++)
+					if (next == -1 || tree[c].games > tree[next].games)
+						next = c;
+				node = next;
+			}
+			moves.push_back(a);
 		}
+		std::stable_sort(moves.begin(), moves.end(), [](const analysis &a, const analysis &b)
+						 { return a.visits > b.visits; });
+		return moves;
+	}
+
+	/**
+	 * register the running search for interrupt()
+	 */
+	void activate(SearchLimit *limit)
+	{
+		std::lock_guard<std::mutex> guard(active_mutex);
+		active = limit;
 	}
 
 public:
-	Node *selectchild(board &state, Node *node)
+
+	/**
+	 * run the search threads from the given roots until the limit is reached, the first thread runs on the caller
+	 * return the total number of iterations
+	 */
+	size_t run_workers(const board &state, const std::vector<int> &roots, SearchLimit &limit, int *depth = nullptr)
 	{
-		if (node->children.size() == 0)
+		std::vector<int> counts(threads), depths(threads);
+		auto worker = [&](int k)
 		{
-			return NULL;
+			int t = tree_parallel ? 0 : k;
+			if (roots[t] == -1)
+				return;
+			MCTS mcts(trees[t], playouts[k], who, tree_parallel && threads > 1, table.get(), symmetric, batch, rave, widen, network.get(),
+					  solve && !lost ? &solvers[k] : nullptr, solve, solve_leaf);
+			counts[k] = mcts.run(state, roots[t], limit);
+			depths[k] = mcts.max_depth();
+		};
+		std::vector<std::thread> helpers;
+		for (int k = 1; k < threads; k++)
+			helpers.emplace_back(worker, k);
+		worker(0);
+		for (std::thread &helper : helpers)
+			helper.join();
+		if (depth)
+			*depth = *std::max_element(depths.begin(), depths.end());
+		return std::accumulate(counts.begin(), counts.end(), size_t(0));
+	}
+
+	/**
+	 * keep searching in the background on the opponent's time, from the state after our last move
+	 * the subtrees under our last move are expanded, so that they can be reused by the next take_action
+	 */
+	virtual void ponder(const board &state)
+	{
+		stop_pondering();
+		if (!pondering || last_move == -1)
+			return;
+		std::vector<int> ponder_roots;
+		for (size_t t = 0; t < trees.size(); t++)
+			ponder_roots.push_back(find_child(trees[t], roots[t], last_move));
+		if (std::count(ponder_roots.begin(), ponder_roots.end(), -1) == int(ponder_roots.size()))
+			return;
+		ponder_limit.reset(new SearchLimit(INT_MAX));
+		ponder_thread = std::thread([this, state, ponder_roots]()
+									{ run_workers(state, ponder_roots, *ponder_limit); });
+	}
+
+	/**
+	 * stop the background search, which returns after the running iteration of each thread
+	 */
+	virtual void stop_pondering()
+	{
+		if (!ponder_thread.joinable())
+			return;
+		ponder_limit->stop();
+		ponder_thread.join();
+	}
+
+	/**
+	 * the number of iterations of the last search
+	 */
+	size_t iterations() const { return last_iterations; }
+
+	/**
+	 * the number of playouts of the last search, i.e., batch playouts per iteration
+	 */
+	size_t simulations() const { return last_iterations * batch; }
+
+	/**
+	 * the visits of each move at the root of the last search, summed over the trees
+	 */
+	const std::array<int, board::size_x * board::size_y> &visits() const { return last_visits; }
+	const std::array<int, board::size_x * board::size_y> &wins() const { return last_wins; }
+
+	/**
+	 * let the helpers join the root parallelism of the following searches, or nullptr to search alone
+	 */
+	void help(search_helpers *h) { helpers = h; }
+
+	/**
+	 * the number of nodes allocated in the trees, i.e., the memory of the last search
+	 */
+	size_t nodes() const
+	{
+		size_t n = 0;
+		for (const NodePool &tree : trees)
+			n += tree.size();
+		return n;
+	}
+
+	/**
+	 * the bytes of the trees and the transposition table, i.e., the memory allocated for the search
+	 */
+	size_t memory() const
+	{
+		size_t bytes = table ? table->memory() : 0;
+		for (const NodePool &tree : trees)
+			bytes += tree.capacity() * sizeof(Node);
+		return bytes;
+	}
+
+	/**
+	 * the counters of the last search, see search_counters
+	 */
+	virtual search_counters counters() const
+	{
+		search_counters c;
+		if (!last_iterations && last_solved)
+		{
+			c.nodes = last_solved;
+			c.depth = last_depth;
+			c.memory = solvers[0].memory();
+			return c;
 		}
-		vector<Node *> sortedChildNodes(node->children);
-		// sort the children by its UCT value
-		sort(begin(sortedChildNodes), end(sortedChildNodes), [](Node *x, Node *y)
-			 { return x->UCTvalue() > y->UCTvalue(); });
-		// place the move of the largest UCT child
-		state.place(sortedChildNodes.at(0)->move.position());
-		// return the node with largest UCT value
-		return sortedChildNodes.at(0);
+		c.iterations = last_iterations;
+		c.playouts = simulations();
+		c.nodes = nodes();
+		c.depth = last_depth;
+		c.memory = memory();
+		return c;
 	}
-	Node *selectbestchild(Node *root)
+
+	/**
+	 * the position of the opponent's move which leads from the last searched state to the given state,
+	 * or -1 if the state does not follow the last search
+	 */
+	int opponent_reply(const board &state) const
+	{
+		if (last_move == -1)
+			return -1;
+		board::piece_type opp = board::piece_type(3 - who);
+		bitboard own = last_state.mask(who) | bitboard::bit(last_move);
+		bitboard added = state.mask(opp) & ~last_state.mask(opp);
+		if (state.mask(who) != own || (state.mask(opp) & last_state.mask(opp)) != last_state.mask(opp))
+			return -1;
+		if (!added || added != added.lowest())
+			return -1;
+		return added.lsb();
+	}
+
+	/**
+	 * the position of a root child proven to win in any of the trees, otherwise the given position unless it is proven
+	 * to lose, in which case the most visited child not proven to lose (in the order of the given tree) is taken instead,
+	 * since the statistics of a proven child stop at its proof
+	 */
+	int proven_move(const NodePool &tree, int root, const std::array<int, board::size_x * board::size_y> &games, int position) const
+	{
+		bitboard lost;
+		for (size_t t = 0; t < trees.size(); t++)
+		{
+			const Node &r = trees[t][roots[t]];
+			for (int child = r.first_child; child < r.first_child + r.child_count; child++)
+			{
+				if (trees[t][child].solved() > 0)
+					return trees[t][child].position;
+				if (trees[t][child].solved() < 0)
+					lost |= bitboard::bit(trees[t][child].position);
+			}
+		}
+		if (position == -1 || !lost.test(position))
+			return position;
+		int best = position;
+		for (int child = tree[root].first_child; child < tree[root].first_child + tree[root].child_count; child++)
+		{
+			int p = tree[child].position;
+			if (!lost.test(p) && (lost.test(best) || games[p] > games[best]))
+				best = p;
+		}
+		return best;
+	}
+
+	/**
+	 * the child of the node with the given position, or -1 if there is no such child
+	 */
+	static int find_child(const NodePool &tree, int node, int position)
+	{
+		if (node == -1 || position == -1)
+			return -1;
+		for (int child = tree[node].first_child; child < tree[node].first_child + tree[node].child_count; child++)
+		{
+			if (tree[child].position == position)
+				return child;
+		}
+		return -1;
+	}
+
+public:
+	/**
+	 * return the position of the best root child by the merged statistics, or -1 if there is no child
+	 * the children are visited in the order of the given tree, so that a single tree gives the same choice
+	 * with RAVE, the search already focuses on the promising moves, so the most visited child is taken instead,
+	 * and the win rates only break the ties
+	 */
+	int selectbestchild(const NodePool &tree, int root, const std::array<int, board::size_x * board::size_y> &win,
+						const std::array<int, board::size_x * board::size_y> &games)
 	{
 		double score;
 		double max_score = -1;
-		if (root->children.size() > 0)
+		if (tree[root].child_count > 0)
 		{
-			Node *best_child = root->children[0];
-			// std::cout<<"select child for"<<std::endl;
-			for (Node *child : root->children)
+			int best_child = tree[tree[root].first_child].position;
+			for (int child = tree[root].first_child; child < tree[root].first_child + tree[root].child_count; child++)
 			{
-				score = ((double)child->win / child->games);
+				int position = tree[child].position;
+				score = ((double)win[position] / games[position]);
+				if (rave)
+					score = games[position] + (games[position] ? score : 0);
 				if (score > max_score)
 				{
 					max_score = score;
-					best_child = child;
+					best_child = position;
 				}
 			}
 			return best_child;
 		}
-		return nullptr;
+		return -1;
 	}
-	bool is_terminal(const board &cur_state)
-	{
-		int legal_count = 0;
 
-		for (const action::place &move : space)
-		{
-			board after = cur_state;
-			if (after.place(move.position()) == board::legal)
-				legal_count++;
-		}
-		if (legal_count == 0)
-		{
-			return true;
-		}
-		return false;
-	}
 
 private:
-	std::vector<action::place> space;
 	board::piece_type who;
 	int simulation_time = 100;
-	Node *root = nullptr;
+	int budget_ms = 0;
+	int game_time = 0;
+	int time_left = 0;
+	int threads = 1;
+	bool tree_parallel = false;
+	size_t node_limit = 1 << 21;
+	size_t last_iterations = 0;
+	int last_depth = 0;
+	std::array<int, board::size_x * board::size_y> last_visits = {};
+	std::array<int, board::size_x * board::size_y> last_wins = {};
+	bool reuse = false;
+	board last_state;
+	int last_move = -1;
+	std::vector<NodePool> trees;
+	std::vector<int> roots;
+	std::unique_ptr<TranspositionTable> table;
+	std::unique_ptr<opening_book> book;
+	uint32_t book_min = 16; // the games of a move to be played from the book
+	bool symmetric = false;
+	int batch = 1;
+	float rave = 0; // the equivalence parameter of RAVE, or 0 for the plain UCT
+	int widen = 0; // the initial children of progressive widening, or 0 to expand all the children at once
+	std::unique_ptr<batch_evaluator> network; // the evaluator of the leaves instead of the playouts, if any
+	bool alphabeta = false; // play by the alpha-beta search of the solver instead of MCTS
+	int depth = 3; // the depth of the alpha-beta search
+	int solve = 0; // solve the positions with at most this number of legal moves, or 0 to never solve
+	size_t solve_nodes = 1 << 20; // the budget of the solver at the root
+	size_t solve_leaf = 0; // the budget of the solver at each leaf of MCTS, or 0 to prove only the ends of the game
+	std::vector<Solver> solvers; // the solver of each thread
+	size_t last_solved = 0; // the nodes of the last search by the solver, or 0 if searched by MCTS
+	bool lost = false; // whether the current move is proven lost by the solver
+	std::string arguments; // the arguments of the player, for the helpers
+	search_helpers *helpers = nullptr;
+	bool pondering = false;
+	std::unique_ptr<SearchLimit> ponder_limit;
+	std::thread ponder_thread;
+	std::vector<batch_playout> playouts;
+	std::mutex active_mutex;
+	SearchLimit *active = nullptr; // the running search, see interrupt()
+	static constexpr size_t max_pv = 16;
 };
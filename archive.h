@@ -0,0 +1,322 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * archive.h: Compact binary format for the records of the episodes
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "board.h"
+#include "action.h"
+#include "episode.h"
+
+/**
+ * the binary archive of episodes, as an alternative to the SGF text
+ *
+ * the file is a header, the records, and an index of the records, i.e.,
+ *   header: "NOGOREC" '\0', uint32 version, uint32 cells of the board
+ *   record: uint32 size of the rest of the record, uint8 winner (0 = black, 1 = white), uint8 reserved,
+ *           uint16 number of moves, then
+ *           varint tag size, tag of open ("black:white"), varint tag size, tag of close (the winner),
+ *           varint open time (ms since epoch), varint duration (ms),
+ *           one byte per move as the position index, or 0xff followed by a varint of the raw action code,
+ *           and a varint per move as its time (us, or ms in the archives of version 1)
+ *   index:  uint64 offset of each record, uint64 number of records, "NOGOIDX" '\0'
+ * all the integers are little-endian, the varints are unsigned LEB128
+ *
+ * the index is written when the writer is closed, the records of a file without the index (e.g., after a crash)
+ * are found by skipping through the sizes of the records instead
+ * the counters of the searches are not kept, see episode::move for the text records with them
+ */
+class archive {
+public:
+	class writer;
+	class reader;
+
+	/**
+	 * whether the file starts with the header of the archive
+	 */
+	static bool is_archive(const std::string& path) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		char buf[8] = {};
+		return in.read(buf, sizeof(buf)) && std::memcmp(buf, header_magic(), sizeof(buf)) == 0;
+	}
+
+	/**
+	 * encode an episode as a record, without the leading size
+	 */
+	static std::string encode(const episode& ep) {
+		std::string rec;
+		const std::vector<episode::move>& moves = ep.ep_moves;
+		rec += char(ep.ep_open.tag.find(ep.ep_close.tag) == 0 ? 0 : 1);
+		rec += char(0);
+		put_fixed(rec, uint16_t(moves.size()));
+		put_varint(rec, ep.ep_open.tag.size());
+		rec += ep.ep_open.tag;
+		put_varint(rec, ep.ep_close.tag.size());
+		rec += ep.ep_close.tag;
+		put_varint(rec, uint64_t(ep.ep_open.when));
+		put_varint(rec, uint64_t(ep.ep_close.when - ep.ep_open.when));
+		for (size_t i = 0; i < moves.size(); i++) {
+			action::place mv(moves[i].code);
+			unsigned type = moves[i].code.type();
+			bool place = type == action::place::type || type == action::black::type || type == action::white::type;
+			unsigned who = i % 2 ? board::white : board::black;
+			if (place && mv.color() == who && mv.position().i >= 0 && mv.position().i < 0xff) {
+				rec += char(mv.position().i);
+			} else {
+				rec += char(0xff);
+				put_varint(rec, unsigned(moves[i].code));
+			}
+		}
+		for (const episode::move& mv : moves) put_varint(rec, uint64_t(mv.time));
+		return rec;
+	}
+
+	/**
+	 * decode a record (without the leading size) of the given size into an episode, of the given version
+	 * return false if the record is malformed
+	 */
+	static bool decode(const char* it, size_t size, episode& ep, uint32_t version = archive::version) {
+		const char* end = it + size;
+		ep = {};
+		if (size < 4) return false;
+		uint16_t count = get_fixed<uint16_t>(it + 2);
+		it += 4;
+		uint64_t len, when, duration;
+		if (!get_varint(it, end, len) || uint64_t(end - it) < len) return false;
+		ep.ep_open.tag.assign(it, len);
+		it += len;
+		if (!get_varint(it, end, len) || uint64_t(end - it) < len) return false;
+		ep.ep_close.tag.assign(it, len);
+		it += len;
+		if (!get_varint(it, end, when) || !get_varint(it, end, duration)) return false;
+		ep.ep_open.when = time_t(when);
+		ep.ep_close.when = time_t(when + duration);
+		ep.ep_moves.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			if (it == end) return false;
+			uint8_t pos = uint8_t(*(it++));
+			if (pos != 0xff) {
+				ep.ep_moves[i].code = action::place(pos, i % 2 ? board::white : board::black);
+			} else {
+				uint64_t code;
+				if (!get_varint(it, end, code)) return false;
+				ep.ep_moves[i].code = action(unsigned(code));
+			}
+		}
+		for (size_t i = 0; i < count; i++) {
+			uint64_t time;
+			if (!get_varint(it, end, time)) return false;
+			ep.ep_moves[i].time = time_t(version == 1 ? time * 1000 : time);
+		}
+		ep.ep_score = 0;
+		return it == end;
+	}
+
+private:
+	static const char* header_magic() { return "NOGOREC"; }
+	static const char* index_magic() { return "NOGOIDX"; }
+	static constexpr uint32_t version = 2;
+	static constexpr size_t header_size = 16;
+	static constexpr size_t trailer_size = 16;
+
+	template<typename type> static void put_fixed(std::string& buf, type v) {
+		for (size_t i = 0; i < sizeof(type); i++) buf += char((v >> (8 * i)) & 0xff);
+	}
+	template<typename type> static type get_fixed(const char* it) {
+		type v = 0;
+		for (size_t i = 0; i < sizeof(type); i++) v |= type(uint8_t(it[i])) << (8 * i);
+		return v;
+	}
+	static void put_varint(std::string& buf, uint64_t v) {
+		for (; v >= 0x80; v >>= 7) buf += char(0x80 | (v & 0x7f));
+		buf += char(v);
+	}
+	static bool get_varint(const char*& it, const char* end, uint64_t& v) {
+		v = 0;
+		for (unsigned shift = 0; it != end && shift < 64; shift += 7) {
+			uint8_t byte = uint8_t(*(it++));
+			v |= uint64_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+};
+
+/**
+ * memory-mapped random access to the records of an archive
+ */
+class archive::reader {
+public:
+	reader(const std::string& path) : base(nullptr), length(0), version(0) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) throw std::runtime_error("cannot open " + path);
+		struct stat st;
+		if (::fstat(fd, &st) == 0) length = st.st_size;
+		if (length >= header_size) {
+			void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED) base = static_cast<const char*>(map);
+		}
+		::close(fd);
+		if (base) version = get_fixed<uint32_t>(base + 8);
+		if (!base || std::memcmp(base, header_magic(), 8) != 0 || version < 1 || version > archive::version
+		          || get_fixed<uint32_t>(base + 12) != board::size_x * board::size_y) {
+			if (base) ::munmap(const_cast<char*>(base), length);
+			throw std::runtime_error("invalid archive " + path);
+		}
+		index();
+	}
+	~reader() { ::munmap(const_cast<char*>(base), length); }
+
+	reader(const reader&) = delete;
+	reader& operator =(const reader&) = delete;
+
+	size_t size() const { return offsets.size(); }
+	uint64_t offset(size_t i) const { return offsets[i]; }
+
+	/**
+	 * the position right after the last record, i.e., where the index begins
+	 */
+	uint64_t records_end() const { return end; }
+
+	/**
+	 * decode the i-th record, throw if the record is malformed
+	 */
+	episode operator [](size_t i) const {
+		episode ep;
+		if (!decode(base + offsets[i] + 4, get_fixed<uint32_t>(base + offsets[i]), ep, version))
+			throw std::runtime_error("malformed record " + std::to_string(i));
+		return ep;
+	}
+
+	/**
+	 * the fields of the fixed header of the i-th record, without decoding the record
+	 */
+	board::piece_type winner(size_t i) const { return base[offsets[i] + 4] ? board::white : board::black; }
+	size_t moves(size_t i) const { return get_fixed<uint16_t>(base + offsets[i] + 6); }
+
+	/**
+	 * the version of the file, e.g., 1 for the older archives with the times of the moves in ms
+	 */
+	uint32_t file_version() const { return version; }
+
+private:
+	/**
+	 * take the offsets from the index, or find the valid records one by one if the index is missing or broken,
+	 * where the index is broken if any of its records is out of the records, e.g., of a truncated archive
+	 */
+	void index() {
+		if (length >= header_size + trailer_size && std::memcmp(base + length - 8, index_magic(), 8) == 0) {
+			uint64_t count = get_fixed<uint64_t>(base + length - trailer_size);
+			if (count <= (length - header_size - trailer_size) / 8) {
+				end = length - trailer_size - count * 8;
+				offsets.resize(count);
+				bool valid = true;
+				for (size_t i = 0; i < count && valid; i++) {
+					offsets[i] = get_fixed<uint64_t>(base + end + i * 8);
+					valid = within(offsets[i], end);
+				}
+				if (valid) return;
+			}
+		}
+		offsets.clear();
+		for (end = header_size; length - end >= 4; ) {
+			uint64_t size = get_fixed<uint32_t>(base + end);
+			episode ep;
+			if (length - end - 4 < size || !decode(base + end + 4, size, ep, version)) break; // a partially written record
+			offsets.push_back(end);
+			end += 4 + size;
+		}
+	}
+
+	/**
+	 * whether the record at the offset is within the records before the end, including its fixed header
+	 */
+	bool within(uint64_t offset, uint64_t end) const {
+		if (offset < header_size || offset > end || end - offset < 8) return false;
+		uint64_t size = get_fixed<uint32_t>(base + offset);
+		return size >= 4 && end - offset - 4 >= size;
+	}
+
+private:
+	const char* base;
+	size_t length;
+	uint32_t version;
+	uint64_t end;
+	std::vector<uint64_t> offsets;
+};
+
+/**
+ * append the records to an archive, and write the index when closed
+ * with append, the records of an existing archive are kept and its index is rewritten at the end
+ */
+class archive::writer {
+public:
+	writer(const std::string& path, bool append = false) : path(path), offset(header_size) {
+		if (append && is_archive(path)) {
+			reader old(path);
+			if (old.file_version() != version) throw std::runtime_error("cannot append to an older archive " + path);
+			offsets.reserve(old.size());
+			for (size_t i = 0; i < old.size(); i++) offsets.push_back(old.offset(i));
+			offset = old.records_end();
+			if (::truncate(path.c_str(), offset) != 0) throw std::runtime_error("cannot truncate " + path);
+			out.open(path, std::ios::out | std::ios::binary | std::ios::app);
+		} else {
+			out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+			std::string header(header_magic(), 8);
+			put_fixed(header, version);
+			put_fixed(header, uint32_t(board::size_x * board::size_y));
+			out.write(header.data(), header.size());
+		}
+		if (!out) throw std::runtime_error("cannot open " + path);
+	}
+	~writer() { close(); }
+
+	writer(const writer&) = delete;
+	writer& operator =(const writer&) = delete;
+
+	void write(const episode& ep) { append(encode(ep)); }
+
+	/**
+	 * append an encoded record, see archive::encode
+	 */
+	void append(const std::string& rec) {
+		std::string size;
+		put_fixed(size, uint32_t(rec.size()));
+		out.write(size.data(), size.size());
+		out.write(rec.data(), rec.size());
+		offsets.push_back(offset);
+		offset += size.size() + rec.size();
+	}
+
+	void flush() { out.flush(); }
+
+	void close() {
+		if (!out.is_open()) return;
+		std::string index;
+		index.reserve(offsets.size() * 8 + trailer_size);
+		for (uint64_t off : offsets) put_fixed(index, off);
+		put_fixed(index, uint64_t(offsets.size()));
+		index.append(index_magic(), 8);
+		out.write(index.data(), index.size());
+		out.close();
+	}
+
+private:
+	std::string path;
+	std::ofstream out;
+	std::vector<uint64_t> offsets;
+	uint64_t offset;
+};
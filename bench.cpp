@@ -0,0 +1,304 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * bench.cpp: Benchmarks for the search of the players
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <chrono>
+#include <thread>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "playout.h"
+
+/**
+ * measure the random playouts per second from the initial board on a single thread, e.g.,
+ * playout playouts = 123456, time = 1.000 s, playouts/s = 123456, moves/playout = 45.6
+ */
+void bench_playouts(int budget) {
+	playout rollout(1);
+	size_t playouts = 0, moves = 0;
+	auto start = std::chrono::steady_clock::now(), until = start + std::chrono::milliseconds(budget);
+	std::chrono::steady_clock::time_point now;
+	do {
+		for (int i = 0; i < 256; i++) {
+			board state;
+			rollout.run(state);
+			moves += state.mask(board::black).count() + state.mask(board::white).count();
+		}
+		playouts += 256;
+	} while ((now = std::chrono::steady_clock::now()) < until);
+	std::chrono::duration<double> time = now - start;
+	std::cout << "playout\t" << "playouts = " << playouts << ", ";
+	std::cout << "time = " << std::fixed << std::setprecision(3) << time.count() << " s, ";
+	std::cout << "playouts/s = " << std::setprecision(0) << (playouts / time.count()) << ", ";
+	std::cout << "moves/playout = " << std::setprecision(1) << (double(moves) / playouts) << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * measure the random playouts per second of the batch kernel from the initial board on a single thread, e.g.,
+ * batch   playouts = 123456, time = 1.000 s, playouts/s = 123456, lanes = 8, isa = avx2
+ */
+void bench_batch_playouts(int budget) {
+	batch_playout rollout(1);
+	size_t playouts = 0;
+	board state;
+	auto start = std::chrono::steady_clock::now(), until = start + std::chrono::milliseconds(budget);
+	std::chrono::steady_clock::time_point now;
+	do {
+		for (int i = 0; i < 32; i++) rollout.run(state);
+		playouts += 32 * batch_playout::lanes;
+	} while ((now = std::chrono::steady_clock::now()) < until);
+	std::chrono::duration<double> time = now - start;
+	std::cout << "batch\t" << "playouts = " << playouts << ", ";
+	std::cout << "time = " << std::fixed << std::setprecision(3) << time.count() << " s, ";
+	std::cout << "playouts/s = " << std::setprecision(0) << (playouts / time.count()) << ", ";
+	std::cout << "lanes = " << batch_playout::lanes << ", isa = " << batch_playout::isa() << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * measure the playouts per second of MCTSplayer as the threads scale from 1 to N
+ * each line reports a parallel mode and a thread count, e.g.,
+ * root   threads = 4, playouts = 123456, time = 2.000 s, playouts/s = 61728 (x3.91)
+ */
+void bench_threads(int max_threads, int budget, int moves, const std::string& args) {
+	for (std::string mode : { "root", "tree" }) {
+		double base = 0;
+		for (int threads = 1; threads <= max_threads; threads = threads < max_threads ? std::min(threads * 2, max_threads) : threads + 1) {
+			MCTSplayer bench("name=bench role=black seed=1 timeout=" + std::to_string(budget) +
+			                 " threads=" + std::to_string(threads) + " parallel=" + mode + " " + args);
+			size_t playouts = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < moves; i++) {
+				bench.take_action(board());
+				playouts += bench.simulations();
+			}
+			std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+			double rate = playouts / time.count();
+			if (threads == 1) base = rate;
+			std::cout << mode << "\t" << "threads = " << threads << ", ";
+			std::cout << "playouts = " << playouts << ", ";
+			std::cout << "time = " << std::fixed << std::setprecision(3) << time.count() << " s, ";
+			std::cout << "playouts/s = " << std::setprecision(0) << rate;
+			std::cout << " (x" << std::setprecision(2) << (rate / base) << ")" << std::endl;
+			std::cout.unsetf(std::ios::floatfield);
+		}
+	}
+}
+
+/**
+ * the result of a micro benchmark, i.e., the time per operation over several runs
+ */
+struct measure {
+	std::string name;
+	size_t runs, ops;
+	double mean, sd, min; // ns/op
+	std::vector<std::pair<std::string, double>> extra;
+};
+
+/**
+ * time the body, which performs some operations and returns how many, over the given runs
+ * the repetitions of each run are calibrated once, so that the runs take the budget together,
+ * and the mean, the standard deviation and the minimum of the ns/op of the runs are reported
+ */
+measure time_ops(const std::string& name, int budget, int runs, std::function<size_t()> body) {
+	typedef std::chrono::steady_clock clock;
+	auto start = clock::now();
+	size_t ops = body(); // warm up
+	double once = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	size_t reps = std::max(size_t(budget * 1e6 / runs / std::max(once, 1.0)), size_t(1));
+	std::vector<double> times;
+	for (int r = 0; r < runs; r++) {
+		size_t done = 0;
+		start = clock::now();
+		for (size_t k = 0; k < reps; k++) done += body();
+		times.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / done);
+		ops = done;
+	}
+	measure m = { name, size_t(runs), ops, 0, 0, times[0] };
+	for (double t : times) m.mean += t / runs, m.min = std::min(m.min, t);
+	for (double t : times) m.sd += (t - m.mean) * (t - m.mean) / std::max(runs - 1, 1);
+	m.sd = std::sqrt(m.sd);
+	return m;
+}
+
+/**
+ * the positions of the micro benchmarks, drawn by random games truncated at random plies with a fixed seed,
+ * so that the benchmarks of different builds work on the same positions
+ */
+std::vector<board> bench_positions(size_t n = 64) {
+	std::mt19937 engine(1);
+	std::vector<board> positions;
+	while (positions.size() < n) {
+		board state;
+		for (int ply = engine() % (board::size_x * board::size_y / 2); ply > 0; ply--) {
+			bitboard moves = state.legal_moves(state.info().who_take_turns);
+			if (!moves) break;
+			state.play(moves.select(engine() % moves.count()));
+		}
+		if (state.legal_moves(state.info().who_take_turns)) positions.push_back(state);
+	}
+	return positions;
+}
+
+/**
+ * run the micro benchmarks of the board, the playouts, and the search, e.g.,
+ * place   ns/op = 41.23 +/- 0.52 (min 40.61), ops/s = 24253000, runs = 10
+ * the budget (ms) is shared by all the micro benchmarks, and the ops/s and the other rates are derived from the mean
+ * the results are also written to json (one object per line) if given, and compared with those in baseline if given
+ */
+void bench_suite(int budget, int runs, int simulations, const std::string& args, const std::string& json, const std::string& baseline) {
+	static volatile uint64_t sink; // keep the results, so that the operations are not optimized away
+	std::vector<board> positions = bench_positions();
+	std::vector<std::pair<size_t, int>> places, stones;
+	for (size_t k = 0; k < positions.size(); k++) {
+		bitboard moves = positions[k].legal_moves(positions[k].info().who_take_turns);
+		for (int i : moves) places.emplace_back(k, i);
+		bitboard taken = positions[k].mask(board::black) | positions[k].mask(board::white);
+		for (int i : taken) stones.emplace_back(k, i);
+	}
+	int each = std::max(budget / 6, 1);
+	std::vector<measure> results;
+
+	results.push_back(time_ops("place", each, runs, [&]() {
+		uint64_t sum = 0;
+		for (const std::pair<size_t, int>& mv : places) {
+			board after(positions[mv.first]);
+			sum += after.place(mv.second / board::size_y, mv.second % board::size_y);
+		}
+		sink += sum;
+		return places.size();
+	}));
+	results.push_back(time_ops("liberty", each, runs, [&]() {
+		uint64_t sum = 0;
+		for (const std::pair<size_t, int>& st : stones) {
+			const board& state = positions[st.first];
+			unsigned who = state.mask(board::black).test(st.second) ? board::black : board::white;
+			sum += state.check_liberty(st.second / board::size_y, st.second % board::size_y, who);
+		}
+		sink += sum;
+		return stones.size();
+	}));
+	results.push_back(time_ops("legal", each, runs, [&]() {
+		uint64_t sum = 0;
+		for (const board& state : positions) sum += state.legal_moves(board::black).count() + state.legal_moves(board::white).count();
+		sink += sum;
+		return positions.size() * 2;
+	}));
+	batch_playout rollout(1);
+	for (unsigned n : { 1u, unsigned(batch_playout::lanes) }) {
+		results.push_back(time_ops(n == 1 ? "simulation" : "simulation" + std::to_string(n), each, runs, [&]() {
+			uint64_t sum = 0;
+			for (const board& state : positions) sum += rollout.run(state, n);
+			sink += sum;
+			return positions.size() * n;
+		}));
+	}
+	// a fresh search from a few of the positions per operation, with a fixed number of simulations,
+	// where the player is reseeded before each search, so that every operation repeats the same searches
+	MCTSplayer black("name=bench role=black seed=1 T=" + std::to_string(simulations) + " " + args);
+	MCTSplayer white("name=bench role=white seed=1 T=" + std::to_string(simulations) + " " + args);
+	size_t calls = 0, playouts = 0, nodes = 0;
+	measure search = time_ops("take_action", budget - 5 * each, runs, [&]() {
+		for (size_t k = 0; k < 8; k++) {
+			MCTSplayer& who = positions[k].info().who_take_turns == board::black ? black : white;
+			who.open_episode();
+			who.seed(1);
+			sink += unsigned(who.take_action(positions[k]));
+			playouts += who.simulations();
+			nodes += who.nodes();
+		}
+		calls += 8;
+		return 8;
+	});
+	double second = search.mean * 1e-9 * calls;
+	search.extra = { { "playouts/s", playouts / second }, { "nodes/s", nodes / second } };
+	results.push_back(search);
+
+	std::map<std::string, double> base;
+	if (baseline.size()) {
+		std::ifstream in(baseline);
+		for (std::string line; std::getline(in, line); ) {
+			size_t name = line.find("\"name\": \""), mean = line.find("\"ns/op\": ");
+			if (name == std::string::npos || mean == std::string::npos) continue;
+			name += 9;
+			base[line.substr(name, line.find('"', name) - name)] = std::stod(line.substr(mean + 9));
+		}
+	}
+	std::ofstream out;
+	if (json.size()) out.open(json, std::ios::out | std::ios::trunc);
+	for (const measure& m : results) {
+		std::cout << m.name << "\t" << std::fixed << std::setprecision(2);
+		std::cout << "ns/op = " << m.mean << " +/- " << m.sd << " (min " << m.min << "), ";
+		std::cout << "ops/s = " << std::setprecision(0) << (1e9 / m.mean);
+		for (const std::pair<std::string, double>& kv : m.extra) std::cout << ", " << kv.first << " = " << kv.second;
+		std::cout << ", runs = " << m.runs;
+		if (base.count(m.name)) std::cout << " (" << std::showpos << std::setprecision(1) << (m.mean / base[m.name] - 1) * 100 << std::noshowpos << "%)";
+		std::cout << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+		if (!out.is_open()) continue;
+		out << std::setprecision(6) << "{\"name\": \"" << m.name << "\", \"ns/op\": " << m.mean << ", \"sd\": " << m.sd;
+		out << ", \"min\": " << m.min << ", \"ops/s\": " << (1e9 / m.mean);
+		for (const std::pair<std::string, double>& kv : m.extra) out << ", \"" << kv.first << "\": " << kv.second;
+		out << ", \"runs\": " << m.runs << ", \"ops\": " << m.ops << "}" << std::endl;
+	}
+}
+
+int main(int argc, const char* argv[]) {
+	std::cout << "HollowNoGo-Bench: ";
+	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
+	std::cout << std::endl << std::endl;
+
+	int threads = std::max(std::thread::hardware_concurrency(), 1u);
+	int budget = 1000, moves = 3, runs = 10, simulations = 1000;
+	std::string args, json, baseline;
+	bool micro = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		auto match_arg = [&](std::string flag) -> bool {
+			auto it = arg.find_first_not_of('-');
+			return arg.find(flag, it) == it;
+		};
+		auto next_opt = [&]() -> std::string {
+			auto it = arg.find('=') + 1;
+			return it ? arg.substr(it) : argv[++i];
+		};
+		if (match_arg("threads")) {
+			threads = std::stoi(next_opt());
+		} else if (match_arg("budget")) {
+			budget = std::stoi(next_opt());
+		} else if (match_arg("moves")) {
+			moves = std::stoi(next_opt());
+		} else if (match_arg("args")) {
+			args = next_opt();
+		} else if (match_arg("runs")) {
+			runs = std::max(std::stoi(next_opt()), 2);
+		} else if (match_arg("simulations")) {
+			simulations = std::stoi(next_opt());
+		} else if (match_arg("json")) {
+			json = next_opt();
+		} else if (match_arg("baseline")) {
+			baseline = next_opt();
+		} else if (match_arg("micro")) {
+			micro = true;
+		}
+	}
+
+	bench_suite(budget, runs, simulations, args, json, baseline);
+	if (micro) return 0;
+	std::cout << std::endl;
+
+	bench_playouts(budget);
+	bench_batch_playouts(budget);
+	bench_threads(threads, budget, moves, args);
+
+	return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * bitboard.h: Define the 128-bit mask used by the bitboard representation of the board
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * 128-bit mask, one bit per cell in 1-d array style (i), i.e., bit (0) == "A1", bit (80) == "J9"
+ * boards up to 128 cells (e.g., 11x11) fit in a single mask
+ */
+class bitboard {
+public:
+	__extension__ typedef unsigned __int128 word;
+
+	constexpr bitboard(word w = 0) : w(w) {}
+	constexpr bitboard(uint64_t hi, uint64_t lo) : w((word(hi) << 64) | lo) {}
+	static constexpr bitboard bit(unsigned i) { return word(1) << i; }
+
+public:
+	constexpr bitboard operator ~() const { return ~w; }
+	constexpr bitboard operator &(const bitboard& b) const { return w & b.w; }
+	constexpr bitboard operator |(const bitboard& b) const { return w | b.w; }
+	constexpr bitboard operator ^(const bitboard& b) const { return w ^ b.w; }
+	constexpr bitboard operator <<(unsigned n) const { return w << n; }
+	constexpr bitboard operator >>(unsigned n) const { return w >> n; }
+	bitboard& operator &=(const bitboard& b) { w &= b.w; return *this; }
+	bitboard& operator |=(const bitboard& b) { w |= b.w; return *this; }
+	bitboard& operator ^=(const bitboard& b) { w ^= b.w; return *this; }
+	constexpr bool operator ==(const bitboard& b) const { return w == b.w; }
+	constexpr bool operator !=(const bitboard& b) const { return w != b.w; }
+	constexpr bool operator < (const bitboard& b) const { return w <  b.w; }
+	constexpr explicit operator bool() const { return w != 0; }
+
+public:
+	constexpr bool test(unsigned i) const { return (w >> i) & 1u; }
+	void set(unsigned i) { w |= word(1) << i; }
+	void reset(unsigned i) { w &= ~(word(1) << i); }
+
+	constexpr uint64_t lo() const { return uint64_t(w); }
+	constexpr uint64_t hi() const { return uint64_t(w >> 64); }
+
+	/**
+	 * the number of set bits
+	 */
+	unsigned count() const { return __builtin_popcountll(lo()) + __builtin_popcountll(hi()); }
+
+	/**
+	 * the index of the lowest set bit, or -1 if the mask is empty
+	 */
+	int lsb() const {
+		if (lo()) return __builtin_ctzll(lo());
+		if (hi()) return __builtin_ctzll(hi()) + 64;
+		return -1;
+	}
+
+	/**
+	 * the lowest set bit as a mask
+	 */
+	constexpr bitboard lowest() const { return w & (~w + 1); }
+
+	/**
+	 * the index of the k-th (0-based, from the lowest) set bit, k should be less than count()
+	 */
+	int select(unsigned k) const {
+		uint64_t part = lo();
+		unsigned base = 0, n = __builtin_popcountll(part);
+		if (k >= n) {
+			k -= n;
+			part = hi();
+			base = 64;
+		}
+#if defined(__BMI2__)
+		return base + __builtin_ctzll(_pdep_u64(uint64_t(1) << k, part));
+#else
+		while (k--) part &= part - 1;
+		return base + __builtin_ctzll(part);
+#endif
+	}
+
+public:
+	/**
+	 * iterate the indices of the set bits from the lowest, e.g., for (int i : mask) { ... }
+	 */
+	class iterator {
+	public:
+		iterator(word rest) : rest(rest) {}
+		int operator *() const { return bitboard(rest).lsb(); }
+		iterator& operator ++() { rest &= rest - 1; return *this; }
+		bool operator !=(const iterator& it) const { return rest != it.rest; }
+	private:
+		word rest;
+	};
+	iterator begin() const { return iterator(w); }
+	iterator end() const { return iterator(0); }
+
+private:
+	word w;
+};
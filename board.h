@@ -9,12 +9,12 @@
 
 #pragma once
 #include <array>
-#include <list>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
 #include <utility>
 #include <cmath>
+#include "bitboard.h"
 
 /**
  * definition for the 9x9 board
@@ -39,12 +39,20 @@
  * 2-d array style is operated as [x][y]:
  *   [0][0] == "A1", [1][2] == "B3", [7][3] == "H4", [8][8] == "J9"
  *
+ * the pieces are stored as one bitboard per piece type, with bits in 1-d array style
+ *
  * for 9x9 Hollow NoGo, the empty locations are hollow but not empty, cannot be counted as liberty,
  * i.e., there are also borders at the center of the board
+ *
+ * the size and the hollow cells are given by the layout policy, see hollow_layout and plain_layout,
+ * so that all the masks of the geometry are constants of each instance, e.g., basic_board<hollow_layout<11>>
+ * the board of the framework is selected at compile time by NOGO_SIZE (9 by default), see the typedef below
  */
-class board {
+template<typename layout>
+class basic_board {
 public:
-	enum size { size_x = 9u, size_y = 9u, hollow_x = 3u, hollow_y = 3u };
+	enum size { size_x = layout::size_x, size_y = layout::size_y };
+	static_assert(size_x * size_y <= 128, "the board should fit in a bitboard");
 	enum piece_type { empty = 0u, black = 1u, white = 2u, hollow = 3u, unknown = -1u };
 	typedef uint32_t cell;
 	typedef std::array<cell, size_y> column;
@@ -56,10 +64,16 @@ public:
 	typedef int reward;
 
 public:
-	board() : stone(initial()), attr({piece_type::black}) {}
-	board(const grid& b, const data& d) : stone(b), attr(d) {}
-	board(const board& b) = default;
-	board& operator =(const board& b) = default;
+	basic_board() : stone(initial_stone), atari(), attr({piece_type::black}), zhash(initial_hash) {}
+	basic_board(const grid& b, const data& d) : stone(), attr(d) {
+		for (int x = 0; x < size_x; x++)
+			for (int y = 0; y < size_y; y++)
+				stone[std::min(b[x][y], cell(hollow))].set(x * size_y + y);
+		rescan_atari();
+		rehash();
+	}
+	basic_board(const basic_board& b) = default;
+	basic_board& operator =(const basic_board& b) = default;
 
 	struct point {
 		int x, y, i;
@@ -77,25 +91,84 @@ public:
 		}
 	};
 
-	operator grid&() { return stone; }
-	operator const grid&() const { return stone; }
-	column& operator [](unsigned x) { return stone[x]; }
-	const column& operator [](unsigned x) const { return stone[x]; }
-	cell& operator ()(unsigned i) { point p(i); return stone[p.x][p.y]; }
-	const cell& operator ()(unsigned i) const { point p(i); return stone[p.x][p.y]; }
-	cell& operator ()(const std::string& move) { point p(move); return stone[p.x][p.y]; }
-	const cell& operator ()(const std::string& move) const { point p(move); return stone[p.x][p.y]; }
+	/**
+	 * proxies for accessing the cells as if the board were a grid
+	 * writing a cell through a proxy moves its bit to the mask of the new piece type
+	 */
+	class cell_ref {
+	public:
+		cell_ref(basic_board& b, unsigned i) : b(b), i(i) {}
+		operator cell() const { return b.at(i); }
+		cell_ref& operator =(cell type) { b.set(i, type); return *this; }
+		cell_ref& operator =(const cell_ref& c) { return operator =(cell(c)); }
+	private:
+		basic_board& b;
+		unsigned i;
+	};
+	class column_ref {
+	public:
+		column_ref(basic_board& b, unsigned x) : b(b), x(x) {}
+		cell_ref operator [](unsigned y) const { return cell_ref(b, x * size_y + y); }
+	private:
+		basic_board& b;
+		unsigned x;
+	};
+	class const_column_ref {
+	public:
+		const_column_ref(const basic_board& b, unsigned x) : b(b), x(x) {}
+		cell operator [](unsigned y) const { return b.at(x * size_y + y); }
+	private:
+		const basic_board& b;
+		unsigned x;
+	};
+
+	operator grid() const {
+		grid g;
+		for (int x = 0; x < size_x; x++)
+			for (int y = 0; y < size_y; y++)
+				g[x][y] = at(x * size_y + y);
+		return g;
+	}
+	column_ref operator [](unsigned x) { return column_ref(*this, x); }
+	const_column_ref operator [](unsigned x) const { return const_column_ref(*this, x); }
+	cell_ref operator ()(unsigned i) { return cell_ref(*this, i); }
+	cell operator ()(unsigned i) const { return at(i); }
+	cell_ref operator ()(const std::string& move) { return cell_ref(*this, point(move).i); }
+	cell operator ()(const std::string& move) const { return at(point(move).i); }
+
+	/**
+	 * the mask of cells occupied by the given piece type
+	 */
+	const bitboard& mask(unsigned type) const { return stone[type]; }
 
 	data info() const { return attr; }
-	data info(data dat) { data old = attr; attr = dat; return old; }
+	data info(data dat) { data old = attr; attr = dat; rehash(); return old; }
+
+	/**
+	 * the 64-bit zobrist hash of the pieces and the side to move, updated incrementally by place()
+	 * boards with the same pieces and the same side to move have equal hashes, while the comparison operators
+	 * compare only the pieces, i.e., equal boards with different sides to move have different hashes
+	 */
+	uint64_t hash() const { return zhash; }
+
+	/**
+	 * the hash of the board after who places a stone at i, without placing it
+	 */
+	uint64_t hash_after(int i, unsigned who) const { return zhash ^ zobrist(who, i) ^ zobrist_turn(); }
+
+	/**
+	 * the zobrist key of a piece type at i, mixed from the pair by splitmix64
+	 */
+	static constexpr uint64_t zobrist(unsigned type, int i) { return splitmix(((uint64_t(type) << 8) | uint64_t(i + 1)) * 0x9e3779b97f4a7c15ull); }
+	static constexpr uint64_t zobrist_turn() { return zobrist(white, -1); } // white to move
 
 public:
-	bool operator ==(const board& b) const { return stone == b.stone; }
-	bool operator < (const board& b) const { return stone <  b.stone; }
-	bool operator !=(const board& b) const { return !(*this == b); }
-	bool operator > (const board& b) const { return b < *this; }
-	bool operator <=(const board& b) const { return !(b < *this); }
-	bool operator >=(const board& b) const { return !(*this < b); }
+	bool operator ==(const basic_board& b) const { return stone == b.stone; }
+	bool operator < (const basic_board& b) const { return stone <  b.stone; }
+	bool operator !=(const basic_board& b) const { return !(*this == b); }
+	bool operator > (const basic_board& b) const { return b < *this; }
+	bool operator <=(const basic_board& b) const { return !(b < *this); }
+	bool operator >=(const basic_board& b) const { return !(*this < b); }
 
 public:
 	enum nogo_move_result {
@@ -117,20 +190,9 @@ public:
 		if (who == -1u) who = attr.who_take_turns;
 		if (who != attr.who_take_turns) return nogo_move_result::illegal_turn;
 		if (x == -1 && y == -1) return nogo_move_result::illegal_pass;
-		point p_min(0, 0), p_max(size_x - 1, size_y - 1);
-		if (x < p_min.x || x > p_max.x || y < p_min.y || y > p_max.y) return nogo_move_result::illegal_out_of_range;
-		if (board::initial()[x][y] == piece_type::hollow)             return nogo_move_result::illegal_out_of_range;
-		board test = *this;
-		if (test[x][y] != piece_type::empty) return nogo_move_result::illegal_not_empty;
-		test[x][y] = who; // try put a piece first
-		if (test.check_liberty(x, y, who) == 0) return nogo_move_result::illegal_suicide;
-		unsigned opp = 3u - who;
-		if (x > p_min.x && test.check_liberty(x - 1, y, opp) == 0) return nogo_move_result::illegal_take;
-		if (x < p_max.x && test.check_liberty(x + 1, y, opp) == 0) return nogo_move_result::illegal_take;
-		if (y > p_min.y && test.check_liberty(x, y - 1, opp) == 0) return nogo_move_result::illegal_take;
-		if (y < p_max.y && test.check_liberty(x, y + 1, opp) == 0) return nogo_move_result::illegal_take;
-		stone[x][y] = who; // is legal move!
-		attr.who_take_turns = static_cast<piece_type>(opp);
+		reward result = check_place(x, y, who);
+		if (result != nogo_move_result::legal) return result;
+		play(x * size_y + y); // is legal move!
 		return nogo_move_result::legal;
 	}
 	reward place(const point& p, unsigned who = piece_type::unknown) {
@@ -138,64 +200,137 @@ public:
 	}
 
 	/**
-	 * calculate the liberty of the block of piece at [x][y]
-	 * return >= 0 if [x][y] is placed by who; otherwise return -1
+	 * place a stone of the next side at position i without any check
+	 * i should be in legal_moves() of the next side, e.g., drawn by the random playouts
 	 */
-	int check_liberty(int x, int y, unsigned who) const {
-		grid test = stone;
-		if (test[x][y] != who) return -1;
-
-		int liberty = 0;
-		std::list<point> check;
-		for (check.emplace_back(x, y); check.size(); check.pop_front()) {
-			int x = check.front().x, y = check.front().y;
-			test[x][y] = piece_type::unknown; // prevent recalculate
+	void play(unsigned i) {
+		unsigned who = attr.who_take_turns;
+		stone[empty].reset(i);
+		stone[who].set(i);
+		attr.who_take_turns = static_cast<piece_type>(3u - who);
+		zhash ^= zobrist(who, i) ^ zobrist_turn();
+		update_atari(i, who);
+	}
 
-			point p_min(0, 0), p_max(size_x - 1, size_y - 1);
+	/**
+	 * what unmake() needs to take back a move, i.e., the position and the blocks in atari before the move
+	 */
+	struct undo {
+		unsigned i;
+		std::array<bitboard, 2> atari;
+	};
 
-			cell near_l = x > p_min.x ? test[x - 1][y] : -1u; // left
-			if (near_l == piece_type::empty) liberty++;
-			else if (near_l == who) check.emplace_back(x - 1, y);
+	/**
+	 * play the move at position i as play(), and return the undo of the move
+	 * the moves are taken back by unmake() in the reverse order, so that a search can work on a single board
+	 */
+	undo make(unsigned i) {
+		undo u = { i, atari };
+		play(i);
+		return u;
+	}
+	void unmake(const undo& u) {
+		unsigned who = 3u - attr.who_take_turns;
+		stone[who].reset(u.i);
+		stone[empty].set(u.i);
+		attr.who_take_turns = static_cast<piece_type>(who);
+		zhash ^= zobrist(who, u.i) ^ zobrist_turn();
+		atari = u.atari;
+	}
 
-			cell near_r = x < p_max.x ? test[x + 1][y] : -1u; // right
-			if (near_r == piece_type::empty) liberty++;
-			else if (near_r == who) check.emplace_back(x + 1, y);
+	/**
+	 * check whether who is able to place a stone at [x][y] without modifying the board
+	 * the new block of who and all the adjacent blocks of the opponent are checked in a single pass,
+	 * each block is flooded at most once and the flooding stops as soon as a liberty is reached
+	 * return nogo_move_result::legal if the position is valid, or nogo_move_result::illegal_* if not
+	 */
+	reward check_place(int x, int y, unsigned who) const {
+		point p_min(0, 0), p_max(size_x - 1, size_y - 1);
+		if (x < p_min.x || x > p_max.x || y < p_min.y || y > p_max.y) return nogo_move_result::illegal_out_of_range;
+		unsigned i = x * size_y + y;
+		if (stone[hollow].test(i)) return nogo_move_result::illegal_out_of_range;
+		if (!stone[empty].test(i)) return nogo_move_result::illegal_not_empty;
+		if (who != black && who != white) return nogo_move_result::illegal_turn;
+		bitboard here = bitboard::bit(i), space = stone[empty] & ~here; // try put a piece first
+		if (!has_liberty(here, stone[who] | here, space)) return nogo_move_result::illegal_suicide;
+		const bitboard& opp = stone[3u - who];
+		for (bitboard near = neighbor(here) & opp, seen; near; near &= ~seen) {
+			seen = near.lowest();
+			if (!has_liberty(seen, opp, space, &seen)) return nogo_move_result::illegal_take;
+		}
+		return nogo_move_result::legal;
+	}
 
-			cell near_d = y > p_min.y ? test[x][y - 1] : -1u; // down
-			if (near_d == piece_type::empty) liberty++;
-			else if (near_d == who) check.emplace_back(x, y - 1);
+	/**
+	 * calculate the liberty of the block of piece at [x][y]
+	 * return >= 0 if [x][y] is placed by who; otherwise return -1
+	 */
+	int check_liberty(int x, int y, unsigned who) const {
+		if (who > hollow || !stone[who].test(x * size_y + y)) return -1;
+		return (neighbor(block(bitboard::bit(x * size_y + y), stone[who])) & stone[empty]).count();
+	}
 
-			cell near_u = y < p_max.y ? test[x][y + 1] : -1u; // up
-			if (near_u == piece_type::empty) liberty++;
-			else if (near_u == who) check.emplace_back(x, y + 1);
-		}
-		return liberty;
+	/**
+	 * the set of positions where who can legally place a stone, regardless of whose turn it is
+	 * since the blocks in atari are kept up to date by place(), this takes only a few mask operations:
+	 * a liberty of an opponent block in atari is its last liberty (take), and a position without empty
+	 * neighbors is still safe if it connects to a block of who not in atari (suicide)
+	 */
+	bitboard legal_moves(unsigned who) const {
+		if (who != black && who != white) return {};
+		const bitboard& space = stone[empty];
+		return space & ~neighbor(atari[2u - who]) & (neighbor(space) | neighbor(stone[who] & ~atari[who - 1u]));
 	}
 
-	void transpose() {
-		for (int x = 0; x < size_x; x++) {
-			for (int y = x + 1; y < size_y; y++) {
-				std::swap(stone[x][y], stone[y][x]);
-			}
-		}
+	/**
+	 * the stones of who in the blocks with at most one liberty
+	 */
+	bitboard in_atari(unsigned who) const {
+		if (who != black && who != white) return {};
+		return atari[who - 1];
 	}
 
-	void reflect_horizontal() {
-		for (int y = 0; y < size_y; y++) {
-			for (int x = 0; x < size_x / 2; x++) {
-				std::swap(stone[x][y], stone[size_x - 1 - x][y]);
-			}
+	/**
+	 * compute the set of legal positions of who from scratch
+	 *
+	 * a position is illegal if it is the last liberty of an opponent block (take),
+	 * or if it has no empty neighbor and each adjacent block of who has no other liberty (suicide)
+	 */
+	bitboard scan_legal_moves(unsigned who) const {
+		if (who != black && who != white) return {};
+		bitboard take, safe;
+		const bitboard& space = stone[empty];
+		for (bitboard rest = stone[3u - who]; rest; ) {
+			bitboard blk = block(rest.lowest(), stone[3u - who]);
+			bitboard lib = neighbor(blk) & space;
+			if (lib == lib.lowest()) take |= lib;
+			rest &= ~blk;
+		}
+		for (bitboard rest = stone[who]; rest; ) {
+			bitboard blk = block(rest.lowest(), stone[who]);
+			bitboard lib = neighbor(blk) & space;
+			if (lib != lib.lowest()) safe |= blk;
+			rest &= ~blk;
 		}
+		bitboard suicide = space & ~neighbor(space) & ~neighbor(safe);
+		return space & ~take & ~suicide;
 	}
 
-	void reflect_vertical() {
-		for (int x = 0; x < size_x; x++) {
-			for (int y = 0; y < size_y / 2; y++) {
-				std::swap(stone[x][y], stone[x][size_y - 1 - y]);
-			}
-		}
+	/**
+	 * the 8 symmetries of the board are indexed by s = 0 ~ 7, where s applies the transpose if (s & 4),
+	 * then the horizontal reflection if (s & 2), then the vertical reflection if (s & 1)
+	 * note that the symmetries are only valid if size_x == size_y
+	 */
+	void transform(int s) {
+		for (bitboard& mask : stone) mask = symmetric(mask, s);
+		for (bitboard& mask : atari) mask = symmetric(mask, s);
+		rehash();
 	}
 
+	void transpose() { transform(4); }
+	void reflect_horizontal() { transform(2); }
+	void reflect_vertical() { transform(1); }
+
 	/**
 	 * rotate the board clockwise by given times
 	 */
@@ -213,8 +348,92 @@ public:
 	void rotate_left() { transpose(); reflect_horizontal(); } // counterclockwise
 	void reverse() { reflect_horizontal(); reflect_vertical(); }
 
+	/**
+	 * the position i after the symmetry s
+	 */
+	static int symmetric(int i, int s) {
+		point p(i);
+		int x = p.x, y = p.y;
+		if (s & 4) std::swap(x, y);
+		if (s & 2) x = size_x - 1 - x;
+		if (s & 1) y = size_y - 1 - y;
+		return x * size_y + y;
+	}
+
+	/**
+	 * the mask after the symmetry s, moved with shifts of whole rows, columns, or diagonals
+	 */
+	static bitboard symmetric(const bitboard& m, int s) {
+		bitboard r = m;
+		if (s & 4) { // (x, y) -> (y, x), i.e., the diagonal y - x = d moves by (size_y - 1) * d
+			bitboard t = r & diagonal(0);
+			for (int d = 1; d < size_y; d++)
+				t |= ((r & diagonal(d)) << ((size_y - 1) * d)) | ((r & diagonal(-d)) >> ((size_y - 1) * d));
+			r = t;
+		}
+		if (s & 2) { // (x, y) -> (size_x - 1 - x, y)
+			bitboard t;
+			for (int x = 0; x < size_x; x++)
+				t |= shift(r & col(x), int(size_y) * (int(size_x) - 1 - 2 * x));
+			r = t;
+		}
+		if (s & 1) { // (x, y) -> (x, size_y - 1 - y)
+			bitboard t;
+			for (int y = 0; y < size_y; y++)
+				t |= shift(r & row(y), int(size_y) - 1 - 2 * y);
+			r = t;
+		}
+		return r;
+	}
+
+	/**
+	 * the hashes of the board after each of the 8 symmetries, computed from the stones without transforming the board,
+	 * i.e., symmetric_hashes()[s] is the hash() after transform(s)
+	 */
+	std::array<uint64_t, 8> symmetric_hashes() const {
+		std::array<uint64_t, 8> h;
+		h.fill(attr.who_take_turns == white ? zobrist_turn() : 0);
+		const key_table& keys = zobrist_keys();
+		for (int s = 0; s < 8; s++)
+			for (cell type = black; type <= hollow; type++)
+				for (int i : symmetric(stone[type], s)) h[s] ^= keys[type][i];
+		return h;
+	}
+
+	/**
+	 * the smallest hash among all the symmetries, which is identical for symmetric boards
+	 */
+	uint64_t canonical_hash() const {
+		std::array<uint64_t, 8> h = symmetric_hashes();
+		return *std::min_element(h.begin(), h.end());
+	}
+
+	/**
+	 * the canonical hash after who places a stone at i, given the symmetric_hashes() of the current board
+	 */
+	static uint64_t canonical_hash_after(const std::array<uint64_t, 8>& h, int i, unsigned who) {
+		uint64_t canonical = -1ull;
+		for (int s = 0; s < 8; s++)
+			canonical = std::min(canonical, h[s] ^ zobrist(who, symmetric(i, s)) ^ zobrist_turn());
+		return canonical;
+	}
+
+	/**
+	 * the set of symmetries which map the board onto itself, as a bitmask of s (the identity is always included)
+	 */
+	unsigned symmetries() const {
+		unsigned same = 1;
+		for (int s = 1; s < 8; s++) {
+			bool fixed = true;
+			for (cell type = black; type <= hollow && fixed; type++)
+				fixed = symmetric(stone[type], s) == stone[type];
+			if (fixed) same |= 1u << s;
+		}
+		return same;
+	}
+
 public:
-	friend std::ostream& operator <<(std::ostream& out, const board& b) {
+	friend std::ostream& operator <<(std::ostream& out, const basic_board& b) {
 		std::ios ff(nullptr);
 		ff.copyfmt(out); // make a copy of the original print format
 
@@ -243,7 +462,7 @@ public:
 		out.copyfmt(ff); // restore print format
 		return out;
 	}
-	friend std::istream& operator >>(std::istream& in, board& b) {
+	friend std::istream& operator >>(std::istream& in, basic_board& b) {
 		std::string token;
 		for (int x = 0; x < size_x; x++) in >> token; /* skip X */
 		for (int y = size_y - 1; y >= 0 && in >> token /* skip Y */; in >> token /* skip Y */, y--) {
@@ -274,19 +493,164 @@ public:
 	}
 
 protected:
-	static const grid& initial() { static grid stone; return stone; }
-	static __attribute__((constructor)) void init_initial_scheme() {
-		grid& stone = const_cast<grid&>(initial());
-		stone[4][1] = piece_type::hollow;
-		stone[4][2] = piece_type::hollow;
-		stone[4][6] = piece_type::hollow;
-		stone[4][7] = piece_type::hollow;
-		stone[1][4] = piece_type::hollow;
-		stone[2][4] = piece_type::hollow;
-		stone[6][4] = piece_type::hollow;
-		stone[7][4] = piece_type::hollow;
+	cell at(unsigned i) const {
+		for (cell type = empty; type < hollow; type++)
+			if (stone[type].test(i)) return type;
+		return hollow;
+	}
+	void set(unsigned i, cell type) {
+		for (bitboard& mask : stone) mask.reset(i);
+		stone[std::min(type, cell(hollow))].set(i);
+		rescan_atari();
+		rehash();
+	}
+
+	void rehash() {
+		zhash = attr.who_take_turns == white ? zobrist_turn() : 0;
+		for (cell type = black; type <= hollow; type++)
+			for (int i : stone[type]) zhash ^= zobrist_keys()[type][i];
+	}
+
+	static constexpr uint64_t splitmix(uint64_t z, int step = 0) {
+		return step == 0 ? splitmix((z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull, 1) :
+		       step == 1 ? splitmix((z ^ (z >> 27)) * 0x94d049bb133111ebull, 2) : z ^ (z >> 31);
+	}
+
+	/**
+	 * find the blocks in atari, i.e., the blocks with at most one liberty, from scratch
+	 */
+	void rescan_atari() {
+		atari = {};
+		for (unsigned who = black; who <= white; who++)
+			for (bitboard rest = stone[who], blk; rest; rest &= ~blk)
+				mark_atari(who, blk = block(rest.lowest(), stone[who]));
+	}
+
+	/**
+	 * refresh the blocks in atari after who placed a stone at i
+	 * only the new block and the adjacent blocks of the opponent change their liberties
+	 */
+	void update_atari(unsigned i, unsigned who) {
+		bitboard here = bitboard::bit(i);
+		mark_atari(who, block(here, stone[who]));
+		for (bitboard near = neighbor(here) & stone[3u - who], blk; near; near &= ~blk)
+			mark_atari(3u - who, blk = block(near.lowest(), stone[3u - who]));
+	}
+
+	void mark_atari(unsigned who, const bitboard& blk) {
+		bitboard lib = neighbor(blk) & stone[empty];
+		if (lib == lib.lowest()) atari[who - 1] |= blk;
+		else atari[who - 1] &= ~blk;
+	}
+
+public:
+	/**
+	 * masks of the board geometry, in 1-d array style
+	 */
+	static constexpr bitboard cells(unsigned n = size_x * size_y) {
+		return n ? cells(n - 1) | bitboard::bit(n - 1) : bitboard();
+	}
+	static constexpr bitboard row(unsigned y, unsigned x = 0) {
+		return x < size_x ? row(y, x + 1) | bitboard::bit(x * size_y + y) : bitboard();
+	}
+	static constexpr bitboard col(unsigned x) {
+		return cells(size_y) << (x * size_y);
+	}
+	static constexpr bitboard diagonal(int d, int x = 0) { // the cells where y - x == d
+		return x < int(size_x) ? diagonal(d, x + 1) | (x + d >= 0 && x + d < int(size_y) ? bitboard::bit(x * size_y + x + d) : bitboard()) : bitboard();
+	}
+	static bitboard shift(const bitboard& m, int n) {
+		return n >= 0 ? m << n : m >> -n;
+	}
+
+	/**
+	 * the cells adjacent to any cell of the given mask
+	 */
+	static bitboard neighbor(const bitboard& m) {
+		return (((m & ~row(size_y - 1)) << 1) | ((m & ~row(0)) >> 1) | (m << size_y) | (m >> size_y)) & cells();
+	}
+
+	/**
+	 * the block of connected pieces in stones which contains the seed
+	 */
+	static bitboard block(const bitboard& seed, const bitboard& stones) {
+		bitboard blk = seed & stones;
+		for (bitboard grow = (blk | neighbor(blk)) & stones; grow != blk; grow = (blk | neighbor(blk)) & stones) blk = grow;
+		return blk;
+	}
+
+protected:
+	/**
+	 * whether the block of connected pieces in stones which contains the seed has any liberty in space
+	 * the flooded part of the block is merged into visited if given
+	 */
+	static bool has_liberty(const bitboard& seed, const bitboard& stones, const bitboard& space, bitboard* visited = nullptr) {
+		bitboard blk = seed & stones;
+		for (bitboard near = neighbor(blk); !(near & space); near = neighbor(blk)) {
+			bitboard grow = (blk | near) & stones;
+			if (grow == blk) {
+				if (visited) *visited |= blk;
+				return false;
+			}
+			blk = grow;
+		}
+		if (visited) *visited |= blk;
+		return true;
+	}
+
+	/**
+	 * the stones and the hash of the empty board, i.e., only the hollow cells of the layout
+	 */
+	static const std::array<bitboard, 4> initial_stone;
+	static const uint64_t initial_hash;
+	static constexpr uint64_t hollow_hash(unsigned i = 0) {
+		return i < size_x * size_y ? hollow_hash(i + 1) ^ (layout::hollow().test(i) ? zobrist(hollow, i) : 0) : 0;
+	}
+	typedef std::array<std::array<uint64_t, size_x * size_y>, 4> key_table;
+	static const key_table& zobrist_keys() {
+		static key_table keys = []() {
+			key_table keys;
+			for (cell type = empty; type <= hollow; type++)
+				for (int i = 0; i < size_x * size_y; i++) keys[type][i] = zobrist(type, i);
+			return keys;
+		}();
+		return keys;
 	}
 private:
-	grid stone;
+	std::array<bitboard, 4> stone; // indexed by piece_type
+	std::array<bitboard, 2> atari; // the stones of black and white in the blocks with at most one liberty
 	data attr;
+	uint64_t zhash;
+};
+
+template<typename layout>
+const std::array<bitboard, 4> basic_board<layout>::initial_stone = {{ cells() & ~layout::hollow(), {}, {}, layout::hollow() }};
+template<typename layout>
+const uint64_t basic_board<layout>::initial_hash = hollow_hash();
+
+/**
+ * the layout of a plain board of width x height without any hollow cell
+ */
+template<unsigned width, unsigned height = width>
+struct plain_layout {
+	static constexpr unsigned size_x = width, size_y = height;
+	static constexpr bitboard hollow() { return {}; }
 };
+
+/**
+ * the layout of Hollow NoGo on an odd size board, where the hollow cells form a cross through the center,
+ * leaving the center, the cells next to it, and the edges open, e.g., the 8 hollow cells of the 9x9 board above
+ */
+template<unsigned size>
+struct hollow_layout : plain_layout<size> {
+	static_assert(size % 2 == 1 && size >= 7, "the hollow layout needs an odd size of at least 7");
+	static constexpr bitboard hollow(unsigned k = 1) {
+		return k < size - 1 ? hollow(k + 1) | (k + 1 < size / 2 || k > size / 2 + 1 ?
+		       bitboard::bit((size / 2) * size + k) | bitboard::bit(k * size + size / 2) : bitboard()) : bitboard();
+	}
+};
+
+#ifndef NOGO_SIZE
+#define NOGO_SIZE 9
+#endif
+typedef basic_board<hollow_layout<NOGO_SIZE>> board;
@@ -0,0 +1,192 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * book.h: Opening book built from the records of the episodes
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "board.h"
+#include "action.h"
+
+/**
+ * the opening book of the positions after the early moves of the recorded episodes
+ *
+ * the file is a header and the entries sorted by their keys, i.e.,
+ *   header: "NOGOBOOK", uint32 version, uint32 cells of the board, uint64 number of entries
+ *   entry:  uint64 canonical hash of the position after a move, uint32 games, uint32 wins of the side who moved
+ * all the integers are little-endian
+ *
+ * the positions are keyed by the canonical hash (see board::canonical_hash), so that the symmetric openings
+ * share their entries, and a move is looked up by the canonical hash after it, so that no move is transformed
+ * the file is mapped into memory, and each lookup is a binary search per legal move
+ */
+class opening_book {
+public:
+	class builder;
+
+	opening_book(const std::string& path) : base(nullptr), length(0), count(0) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) throw std::runtime_error("cannot open " + path);
+		struct stat st;
+		if (::fstat(fd, &st) == 0) length = st.st_size;
+		if (length >= header_size) {
+			void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED) base = static_cast<const char*>(map);
+		}
+		::close(fd);
+		if (base) count = get_fixed<uint64_t>(base + 16);
+		if (!base || std::memcmp(base, magic(), 8) != 0 || get_fixed<uint32_t>(base + 8) != version
+		          || get_fixed<uint32_t>(base + 12) != board::size_x * board::size_y
+		          || count > (length - header_size) / entry_size) {
+			if (base) ::munmap(const_cast<char*>(base), length);
+			throw std::runtime_error("invalid book " + path);
+		}
+	}
+	~opening_book() { ::munmap(const_cast<char*>(base), length); }
+
+	opening_book(const opening_book&) = delete;
+	opening_book& operator =(const opening_book&) = delete;
+
+	size_t size() const { return count; }
+
+	/**
+	 * the games and the wins (of the side who moved) of the position after who places at i, given the
+	 * symmetric_hashes() of the current board, return false if the position is not in the book
+	 */
+	bool find(const std::array<uint64_t, 8>& hashes, int i, unsigned who, uint32_t& games, uint32_t& wins) const {
+		uint64_t key = board::canonical_hash_after(hashes, i, who);
+		size_t lo = 0, hi = count;
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (get_fixed<uint64_t>(entry(mid)) < key) lo = mid + 1;
+			else hi = mid;
+		}
+		if (lo == count || get_fixed<uint64_t>(entry(lo)) != key) return false;
+		games = get_fixed<uint32_t>(entry(lo) + 8);
+		wins = get_fixed<uint32_t>(entry(lo) + 12);
+		return true;
+	}
+
+	/**
+	 * the move of the side to move with the best win rate among the moves played in at least min_games games
+	 * (the more played one on ties), or -1 if the position is out of the book
+	 */
+	int lookup(const board& state, uint32_t min_games = 1) const {
+		unsigned who = state.info().who_take_turns;
+		bitboard moves = state.legal_moves(who);
+		if (!count || !moves) return -1;
+		std::array<uint64_t, 8> hashes = state.symmetric_hashes();
+		int best = -1;
+		uint32_t best_games = 0, best_wins = 0;
+		for (int i : moves) {
+			uint32_t games, wins;
+			if (!find(hashes, i, who, games, wins) || games < std::max(min_games, 1u)) continue;
+			// compare wins / games without dividing
+			uint64_t rate = uint64_t(wins) * best_games, best_rate = uint64_t(best_wins) * games;
+			if (best == -1 || rate > best_rate || (rate == best_rate && games > best_games)) {
+				best = i;
+				best_games = games;
+				best_wins = wins;
+			}
+		}
+		return best;
+	}
+
+private:
+	static const char* magic() { return "NOGOBOOK"; }
+	static constexpr uint32_t version = 1;
+	static constexpr size_t header_size = 24;
+	static constexpr size_t entry_size = 16;
+
+	const char* entry(size_t k) const { return base + header_size + k * entry_size; }
+
+	template<typename type> static void put_fixed(std::string& buf, type v) {
+		for (size_t i = 0; i < sizeof(type); i++) buf += char((v >> (8 * i)) & 0xff);
+	}
+	template<typename type> static type get_fixed(const char* it) {
+		type v = 0;
+		for (size_t i = 0; i < sizeof(type); i++) v |= type(uint8_t(it[i])) << (8 * i);
+		return v;
+	}
+
+private:
+	const char* base;
+	size_t length;
+	size_t count;
+};
+
+/**
+ * collect the first plies of the episodes, and save the positions played often enough as a book
+ */
+class opening_book::builder {
+public:
+	builder(size_t depth = 10) : depth(depth) {}
+
+	/**
+	 * add the first depth moves of a finished game, given all its actions in order, e.g., episode::actions()
+	 * the winner is the side who made the last move
+	 */
+	template<typename actions> void add(const actions& moves) {
+		if (!moves.size()) return;
+		unsigned winner = moves.size() % 2 ? board::black : board::white;
+		board state;
+		size_t ply = 0;
+		for (action a : moves) {
+			if (ply++ >= depth) break;
+			action::place move(a);
+			unsigned who = state.info().who_take_turns;
+			uint64_t key = board::canonical_hash_after(state.symmetric_hashes(), move.position().i, who);
+			if (move.apply(state) != board::legal) break;
+			record& entry = table[key];
+			entry.games++;
+			if (who == winner) entry.wins++;
+		}
+	}
+
+	size_t size() const { return table.size(); }
+
+	/**
+	 * save the positions played in at least min_games games, return the number of entries saved
+	 */
+	size_t save(const std::string& path, uint32_t min_games = 1) const {
+		std::vector<std::pair<uint64_t, record>> entries;
+		for (const std::pair<const uint64_t, record>& kv : table)
+			if (kv.second.games >= min_games) entries.push_back(kv);
+		std::sort(entries.begin(), entries.end(),
+		          [](const std::pair<uint64_t, record>& a, const std::pair<uint64_t, record>& b) { return a.first < b.first; });
+		std::string buf(magic(), 8);
+		put_fixed(buf, version);
+		put_fixed(buf, uint32_t(board::size_x * board::size_y));
+		put_fixed(buf, uint64_t(entries.size()));
+		buf.reserve(header_size + entries.size() * entry_size);
+		for (const std::pair<uint64_t, record>& kv : entries) {
+			put_fixed(buf, kv.first);
+			put_fixed(buf, kv.second.games);
+			put_fixed(buf, kv.second.wins);
+		}
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.write(buf.data(), buf.size())) throw std::runtime_error("cannot write " + path);
+		return entries.size();
+	}
+
+private:
+	struct record {
+		uint32_t games = 0, wins = 0;
+	};
+	size_t depth;
+	std::unordered_map<uint64_t, record> table;
+};
@@ -0,0 +1,287 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * check.cpp: Self-checks of the board, the batch playouts, and the solver against plain references
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include "board.h"
+#include "playout.h"
+#include "solver.h"
+
+/**
+ * the number of the comparisons made so far, and the first failure if any
+ */
+static size_t checks = 0;
+static void expect(bool ok, const std::string& what, const board& state) {
+	checks++;
+	if (ok) return;
+	std::cerr << "check failed: " << what << std::endl << state;
+	std::exit(1);
+}
+
+/**
+ * whether the block at i has a liberty, by flooding it from scratch on the cells
+ */
+static bool reference_liberty(const std::vector<board::cell>& c, int i) {
+	std::vector<bool> seen(c.size());
+	std::vector<int> stack = { i };
+	seen[i] = true;
+	while (stack.size()) {
+		int k = stack.back();
+		stack.pop_back();
+		int x = k / board::size_y, y = k % board::size_y;
+		int next[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+		for (auto& p : next) {
+			if (p[0] < 0 || p[0] >= board::size_x || p[1] < 0 || p[1] >= board::size_y) continue;
+			int j = p[0] * board::size_y + p[1];
+			if (c[j] == board::empty) return true;
+			if (c[j] == c[i] && !seen[j]) seen[j] = true, stack.push_back(j);
+		}
+	}
+	return false;
+}
+
+static std::vector<board::cell> reference_cells(const board::grid& g) {
+	std::vector<board::cell> cells(board::size_x * board::size_y);
+	for (size_t i = 0; i < cells.size(); i++) cells[i] = g[i / board::size_y][i % board::size_y];
+	return cells;
+}
+
+/**
+ * the legal moves of who on a grid, by flooding each block from scratch on the cells
+ * a move is legal if its block has a liberty afterwards, and so does every adjacent block of the opponent
+ */
+static bitboard reference_legal(const board::grid& g, unsigned who) {
+	const int n = board::size_x * board::size_y;
+	std::vector<board::cell> cells = reference_cells(g);
+	bitboard legal;
+	for (int i = 0; i < n; i++) {
+		if (cells[i] != board::empty) continue;
+		cells[i] = who;
+		bool ok = reference_liberty(cells, i);
+		int x = i / board::size_y, y = i % board::size_y;
+		int next[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+		for (auto& p : next) {
+			if (p[0] < 0 || p[0] >= board::size_x || p[1] < 0 || p[1] >= board::size_y) continue;
+			int j = p[0] * board::size_y + p[1];
+			if (cells[j] == 3u - who) ok = ok && reference_liberty(cells, j);
+		}
+		cells[i] = board::empty;
+		if (ok) legal.set(i);
+	}
+	return legal;
+}
+
+/**
+ * compare the incremental state of a board with the board rebuilt from its grid and with the reference
+ */
+static void check_state(const board& state) {
+	board rebuilt(board::grid(state), state.info());
+	expect(rebuilt == state, "rebuilt stones", state);
+	expect(rebuilt.hash() == state.hash(), "incremental hash", state);
+	for (unsigned who = board::black; who <= board::white; who++) {
+		bitboard legal = reference_legal(board::grid(state), who);
+		expect(state.legal_moves(who) == legal, "legal_moves() of " + std::to_string(who), state);
+		expect(state.scan_legal_moves(who) == legal, "scan_legal_moves() of " + std::to_string(who), state);
+		expect(state.in_atari(who) == rebuilt.in_atari(who), "in_atari() of " + std::to_string(who), state);
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			bool ok = state.check_place(i / board::size_y, i % board::size_y, who) == board::legal;
+			expect(ok == legal.test(i), "check_place() at " + std::to_string(i), state);
+		}
+	}
+}
+
+/**
+ * play random games, where each position is checked, and each legal move is made and taken back
+ * on the same board, which should then be the same as before, and the same as the move played on a copy
+ */
+void check_board(int games, uint64_t seed) {
+	pcg32 engine(seed);
+	size_t positions = 0;
+	for (int g = 0; g < games; g++) {
+		board state;
+		while (true) {
+			check_state(state);
+			positions++;
+			bitboard moves = state.legal_moves(state.info().who_take_turns);
+			if (!moves) break;
+			board before(state);
+			for (int i : moves) {
+				board after(state);
+				expect(after.place(i / board::size_y, i % board::size_y) == board::legal, "place() of a legal move", state);
+				board::undo u = state.make(i);
+				expect(state == after && state.hash() == after.hash() && state.info().who_take_turns == after.info().who_take_turns,
+				       "make() as place() at " + std::to_string(i), state);
+				expect(state.in_atari(board::black) == after.in_atari(board::black)
+				       && state.in_atari(board::white) == after.in_atari(board::white), "atari after make() at " + std::to_string(i), state);
+				state.unmake(u);
+				expect(state == before && state.hash() == before.hash() && state.info().who_take_turns == before.info().who_take_turns
+				       && state.in_atari(board::black) == before.in_atari(board::black)
+				       && state.in_atari(board::white) == before.in_atari(board::white), "unmake() at " + std::to_string(i), state);
+			}
+			state.play(moves.select(engine.bounded(moves.count())));
+		}
+	}
+	std::cout << "board\t" << "games = " << games << ", positions = " << positions << ", checks = " << checks << std::endl;
+}
+
+/**
+ * run the batch playouts (with the kernel selected for the host) from the positions of random games,
+ * where the final stones of each lane should be a finished game played from the position, i.e.,
+ * the stones of the position plus the alternating moves, every block with a liberty, and no legal move
+ * left for the loser, and compare the win rate of black from the initial board with the scalar playouts
+ */
+void check_playouts(int positions, uint64_t seed) {
+	pcg32 engine(seed);
+	batch_playout rollout(seed);
+	size_t lanes = 0;
+	for (int p = 0; p < positions; p++) {
+		board state;
+		for (int ply = engine.bounded(40); ply > 0; ply--) {
+			bitboard moves = state.legal_moves(state.info().who_take_turns);
+			if (!moves) break;
+			state.play(moves.select(engine.bounded(moves.count())));
+		}
+		unsigned n = 1 + engine.bounded(batch_playout::lanes);
+		batch_playout::stones played[batch_playout::lanes];
+		unsigned black_wins = rollout.run(state, n, played);
+		for (unsigned k = 0; k < n; k++, lanes++) {
+			const bitboard& b = played[k][0], & w = played[k][1];
+			expect((b & state.mask(board::black)) == state.mask(board::black) && (w & state.mask(board::white)) == state.mask(board::white)
+			       && !(b & w) && ((b | w) & ~(state.mask(board::black) | state.mask(board::white))) == ((b | w) & state.mask(board::empty)),
+			       "stones of lane " + std::to_string(k), state);
+			int added_b = b.count() - state.mask(board::black).count(), added_w = w.count() - state.mask(board::white).count();
+			int first = added_b - added_w, turn = state.info().who_take_turns;
+			expect(turn == board::black ? (first == 0 || first == 1) : (first == 0 || first == -1), "alternating moves of lane " + std::to_string(k), state);
+			unsigned loser = (added_b + added_w) % 2 ? 3 - turn : turn;
+			board::grid g(state);
+			for (int i = 0; i < board::size_x * board::size_y; i++) {
+				if (b.test(i)) g[i / board::size_y][i % board::size_y] = board::black;
+				if (w.test(i)) g[i / board::size_y][i % board::size_y] = board::white;
+			}
+			board end(g, { board::piece_type(loser) });
+			std::vector<board::cell> cells = reference_cells(g);
+			for (int i = 0; i < board::size_x * board::size_y; i++)
+				if (cells[i] == board::black || cells[i] == board::white) expect(reference_liberty(cells, i), "liberty at the end of lane " + std::to_string(k), end);
+			expect(!reference_legal(g, loser), "no legal move for the loser of lane " + std::to_string(k), end);
+			expect(bool((black_wins >> k) & 1) == (loser == board::white), "result of lane " + std::to_string(k), end);
+		}
+		expect(!(black_wins >> n), "results beyond the lanes", state);
+	}
+
+	// the batch and the scalar playouts should be the same random games, so their win rates should agree
+	const int trials = 20000;
+	board initial;
+	size_t batch_wins = 0, scalar_wins = 0;
+	for (int t = 0; t < trials; t++) {
+		batch_wins += __builtin_popcount(rollout.run(initial, batch_playout::lanes));
+		for (unsigned k = 0; k < batch_playout::lanes; k++) scalar_wins += rollout.run(initial, 1);
+	}
+	double games = double(trials) * batch_playout::lanes;
+	double p = (batch_wins + scalar_wins) / (2 * games), diff = (batch_wins - double(scalar_wins)) / games;
+	expect(std::abs(diff) < 5 * std::sqrt(2 * p * (1 - p) / games), "win rates of the batch and the scalar playouts", initial);
+	std::cout << "batch	" << "isa = " << batch_playout::isa() << ", lanes = " << lanes << ", ";
+	std::cout << "black wins = " << (batch_wins / games) << " (batch) | " << (scalar_wins / games) << " (scalar)" << std::endl;
+}
+
+/**
+ * whether the side to move wins, by the plain minimax over all the moves, or 0 if it takes more than budget nodes
+ */
+static int reference_solve(board& state, size_t& budget) {
+	if (!budget) return 0;
+	budget--;
+	bitboard moves = state.legal_moves(state.info().who_take_turns);
+	int result = -1;
+	for (int i : moves) {
+		board::undo u = state.make(i);
+		int v = -reference_solve(state, budget);
+		state.unmake(u);
+		if (!budget && v != 1) return 0;
+		if (v == 1) {
+			result = 1;
+			break;
+		}
+	}
+	return result;
+}
+
+/**
+ * solve the endgames of random games, and compare the results with the plain minimax, where a winning move
+ * of the solver should also leave the opponent lost; the solvers keep their tables over all the positions,
+ * one of them so small that the entries of the positions are replaced all the time
+ */
+void check_solver(int positions, uint64_t seed) {
+	pcg32 engine(seed);
+	Solver large(16), small(4);
+	int solved = 0, wins = 0;
+	for (int p = 0; p < positions; p++) {
+		board state;
+		while (true) {
+			bitboard moves = state.legal_moves(state.info().who_take_turns);
+			if (!moves || (moves.count() <= 10 && engine.bounded(3) == 0)) break;
+			state.play(moves.select(engine.bounded(moves.count())));
+		}
+		size_t budget = 2000000;
+		int expected = reference_solve(state, budget);
+		if (!expected) continue; // too large for the reference
+		for (Solver* solver : { &large, &small }) {
+			int best = -1;
+			int result = solver->solve(state, SIZE_MAX, &best);
+			expect(result == expected, "result of the solver", state);
+			if (result != 1) continue;
+			expect(state.legal_moves(state.info().who_take_turns).test(best), "legal best move of the solver", state);
+			board after(state);
+			after.play(best);
+			size_t rest = SIZE_MAX;
+			expect(reference_solve(after, rest) == -1, "winning move of the solver", state);
+		}
+		solved++;
+		wins += expected == 1;
+	}
+	std::cout << "solver	" << "positions = " << solved << ", wins = " << wins << ", losses = " << (solved - wins) << std::endl;
+}
+
+int main(int argc, const char* argv[]) {
+	std::cout << "HollowNoGo-Check: ";
+	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
+	std::cout << std::endl << std::endl;
+
+	int games = 200, positions = 5000, endgames = 300;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		auto match_arg = [&](std::string flag) -> bool {
+			auto it = arg.find_first_not_of('-');
+			return arg.find(flag, it) == it;
+		};
+		auto next_opt = [&]() -> std::string {
+			auto it = arg.find('=') + 1;
+			return it ? arg.substr(it) : argv[++i];
+		};
+		if (match_arg("games")) {
+			games = std::stoi(next_opt());
+		} else if (match_arg("positions")) {
+			positions = std::stoi(next_opt());
+		} else if (match_arg("endgames")) {
+			endgames = std::stoi(next_opt());
+		} else if (match_arg("seed")) {
+			seed = std::stoull(next_opt());
+		}
+	}
+
+	check_board(games, seed);
+	check_playouts(positions, seed);
+	check_solver(endgames, seed);
+	std::cout << std::endl << "all " << checks << " checks passed" << std::endl;
+	return 0;
+}
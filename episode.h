@@ -15,6 +15,9 @@
 #include <sstream>
 #include <chrono>
 #include <numeric>
+#include <cctype>
+#include <iomanip>
+#include <iterator>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
@@ -36,15 +39,18 @@ public:
 	void close_episode(const std::string& tag) {
 		ep_close = { tag, millisec() };
 	}
-	bool apply_action(action move) {
-		board::reward reward = move.apply(state());
+	/**
+	 * apply the move with the counters of its search if any, and record the time (us) since take_turns()
+	 */
+	bool apply_action(action move, const search_counters& counters = {}) {
+		board::reward reward = move.action::apply(state()); // move is a plain action, so skip the virtual call
 		if (reward != board::legal) return false;
-		ep_moves.emplace_back(move, reward, millisec() - ep_time);
+		ep_moves.emplace_back(move, reward, microsec() - ep_time, counters);
 		ep_score += reward;
 		return true;
 	}
 	agent& take_turns(agent& black, agent& white) {
-		ep_time = millisec();
+		ep_time = microsec();
 		return (step() % 2) ? white : black;
 	}
 	agent& last_turns(agent& black, agent& white) {
@@ -64,6 +70,9 @@ public:
 		}
 	}
 
+	/**
+	 * the thinking time (us) of the moves of who, or the duration (us, with the resolution of ms) of the episode
+	 */
 	time_t time(unsigned who = -1u) const {
 		time_t time = 0;
 		switch (who) {
@@ -77,48 +86,87 @@ public:
 			break;
 		case action::place::type:
 		default:
-			time = ep_close.when - ep_open.when;
+			time = (ep_close.when - ep_open.when) * 1000;
 			break;
 		}
 		return time;
 	}
 
-	std::vector<action> actions(unsigned who = -1u) const {
-		std::vector<action> res;
+protected:
+	struct move;
+
+public:
+	/**
+	 * a view of the actions of who (or of both sides) in the order they were played, without copying them, e.g.,
+	 * for (action a : ep.actions(board::black)) { ... }
+	 */
+	class action_view {
+	public:
+		class iterator {
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef action value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const action* pointer;
+			typedef action reference;
+			iterator(const action_view& view, size_t k) : view(&view), k(k) {}
+			action operator *() const { return (*view)[k]; }
+			iterator& operator ++() { k++; return *this; }
+			bool operator !=(const iterator& it) const { return k != it.k; }
+		private:
+			const action_view* view;
+			size_t k;
+		};
+		action_view(const move* base, size_t offset, size_t count, size_t stride) : base(base), offset(offset), count(count), stride(stride) {}
+		iterator begin() const { return iterator(*this, 0); }
+		iterator end() const { return iterator(*this, count); }
+		size_t size() const { return count; }
+		action operator [](size_t i) const { return base[offset + i * stride].code; }
+		operator std::vector<action>() const { return std::vector<action>(begin(), end()); }
+	private:
+		const move* base; // the moves are indexed from the base, so that no pointer runs past the end of the moves
+		size_t offset, count, stride;
+	};
+
+	action_view actions(unsigned who = -1u) const {
+		const move* base = ep_moves.data();
 		switch (who) {
 		case board::black:
 		case action::black::type:
-			for (size_t i = 0; i < ep_moves.size(); i += 2) res.push_back(ep_moves[i]);
-			break;
+			return action_view(base, 0, step(board::black), 2);
 		case board::white:
 		case action::white::type:
-			for (size_t i = 1; i < ep_moves.size(); i += 2) res.push_back(ep_moves[i]);
-			break;
+			return action_view(base, 1, step(board::white), 2);
 		case action::place::type:
 		default:
-			res.assign(ep_moves.begin(), ep_moves.end());
-			break;
+			return action_view(base, 0, ep_moves.size(), 1);
 		}
-		return res;
 	}
 
 public:
 
 	friend std::ostream& operator <<(std::ostream& out, const episode& ep) {
+		return ep.write(out);
+	}
+
+	/**
+	 * write the episode as a line of SGF, with the search counters in the comments of the moves if counters
+	 */
+	std::ostream& write(std::ostream& out, bool counters = false) const {
 		out << '(';
 		out << ";FF[4]CA[UTF-8]AP[TCG-NoGo-Demo]";
 		out << "SZ[" << board::size_y;
 		if (board::size_x != board::size_y) out << ':' << board::size_x;
 		out << "]KM[0]";
-		std::string names = ep.ep_open.tag;
+		std::string names = ep_open.tag;
 		out << "PB[" << names.substr(0, names.find(':')) << "]";
 		out << "PW[" << names.substr(names.find(':') + 1) << "]";
-		time_t date = ep.ep_open.when / 1000;
+		time_t date = ep_open.when / 1000;
 		out << "DT[" << std::put_time(std::localtime(&date), "%Y-%m-%d") << "]";
-		std::string winner = ep.ep_close.tag;
+		std::string winner = ep_close.tag;
 		out << "RE[" << (names.find(winner) == 0 ? "B" : "W") << "+R]";
-		out << "C[TCG|" << ep.ep_open << "|" << ep.ep_close << "]";
-		for (const move& mv : ep.ep_moves) out << mv;
+		out << "C[TCG|" << ep_open << "|" << ep_close << "]";
+		for (const move& mv : ep_moves) mv.write(out, counters);
 		out << ')';
 		return out;
 	}
@@ -146,31 +194,95 @@ public:
 		return in;
 	}
 
+	/**
+	 * parse a line of SGF in [begin, end) as operator >>, but by scanning the characters without any stream
+	 * the lines not in the form written by operator << fall back to operator >>
+	 */
+	void parse(const char* begin, const char* end) {
+		if (!scan(begin, end)) std::stringstream(std::string(begin, end)) >> *this;
+	}
+
+	friend class archive;
+	friend class statistics;
+
 protected:
 
+	/**
+	 * a move with its time (us) and the counters of its search
+	 * the comment of a move is the time in ms with 3 decimals, followed by the counters if any, e.g.,
+	 * ;B[ee]C[12.345 it=1000 po=1000 nodes=3012 depth=14 mem=1048576]
+	 * the comments of the integral ms of the older records are also accepted
+	 */
 	struct move {
 		action code;
 		board::reward reward;
 		time_t time;
-		move(action code = {}, board::reward reward = 0, time_t time = 0) : code(code), reward(reward), time(time) {}
+		search_counters counters;
+		move(action code = {}, board::reward reward = 0, time_t time = 0, const search_counters& counters = {})
+			: code(code), reward(reward), time(time), counters(counters) {}
 
 		operator action() const { return code; }
+		std::ostream& write(std::ostream& out, bool with_counters = false) const {
+			out << code << "C[" << std::dec << (time / 1000) << '.';
+			out << std::setw(3) << std::setfill('0') << (time % 1000) << std::setfill(' ');
+			if (with_counters && counters) {
+				out << " it=" << counters.iterations << " po=" << counters.playouts << " nodes=" << counters.nodes;
+				out << " depth=" << counters.depth << " mem=" << counters.memory;
+			}
+			return out << "]";
+		}
 		friend std::ostream& operator <<(std::ostream& out, const move& m) {
-			out << m.code;
-			if (m.time) out << "C[" << std::dec << m.time << "]";
-			return out;
+			return m.write(out);
 		}
 		friend std::istream& operator >>(std::istream& in, move& m) {
 			in >> m.code;
-			m.reward = 0;
-			m.time = 0;
+			m = move(m.code);
 			if (in.peek() == 'C') {
 				in.ignore(2); // C[
-				in >> std::dec >> m.time;
-				in.ignore(1); // ]
+				std::string comment;
+				std::getline(in, comment, ']');
+				comment += ']';
+				const char* it = comment.data();
+				if (!scan_comment(it, it + comment.size(), m)) in.setstate(std::ios::failbit);
 			}
 			return in;
 		}
+
+		/**
+		 * scan the comment of a move after "C[" through its "]", i.e., the time in ms with the optional decimals,
+		 * and the counters of the search as "key=value" separated by spaces
+		 */
+		static bool scan_comment(const char*& it, const char* end, move& m) {
+			auto number = [&](uint64_t& v) -> bool {
+				if (it == end || !std::isdigit(*it)) return false;
+				for (v = 0; it != end && std::isdigit(*it); it++) v = v * 10 + (*it - '0');
+				return true;
+			};
+			uint64_t ms, us = 0;
+			if (!number(ms)) return false;
+			if (it != end && *it == '.') {
+				int digits = 0;
+				for (it++; it != end && std::isdigit(*it); it++, digits++)
+					if (digits < 3) us = us * 10 + (*it - '0');
+				for (; digits < 3; digits++) us *= 10;
+			}
+			m.time = time_t(ms * 1000 + us);
+			while (it != end && *it == ' ') {
+				const char* key = ++it;
+				while (it != end && *it != '=' && *it != ']') it++;
+				std::string name(key, it);
+				uint64_t v;
+				if (it == end || *(it++) != '=' || !number(v)) return false;
+				if (name == "it") m.counters.iterations = v;
+				else if (name == "po") m.counters.playouts = v;
+				else if (name == "nodes") m.counters.nodes = v;
+				else if (name == "depth") m.counters.depth = v;
+				else if (name == "mem") m.counters.memory = v;
+			}
+			if (it == end || *it != ']') return false;
+			it++; // ]
+			return true;
+		}
 	};
 
 	struct meta {
@@ -186,6 +298,47 @@ protected:
 		}
 	};
 
+	/**
+	 * the scanner of parse(), return false if the line should be parsed by operator >> instead
+	 */
+	bool scan(const char* it, const char* end) {
+		*this = {};
+		if (it == end || *it != '(') return false;
+		end = std::find(it, end, ')');
+		static const char head[] = "C[TCG|";
+		it = std::search(it, end, head, head + 6);
+		if (it == end) return false;
+		it += 6;
+		if (!scan_meta(it, end, ep_open) || it++ == end) return false; // |
+		if (!scan_meta(it, end, ep_close) || it++ == end) return false; // ]
+		it = std::find(it, end, ';');
+		while (it != end && *it == ';') {
+			if (end - it < 6) return false;
+			unsigned who = board::empty;
+			if (it[1] == 'B') who = board::black;
+			if (it[1] == 'W') who = board::white;
+			int x = it[3] - 'a';
+			int y = (board::size_y - 1) - (it[4] - 'a');
+			it += 6;
+			ep_moves.emplace_back(action::place(x, y, who));
+			if (it != end && *it == 'C') {
+				if (end - it < 2) return false;
+				it += 2; // C[
+				if (!move::scan_comment(it, end, ep_moves.back())) return false;
+			}
+		}
+		ep_score = 0;
+		return true;
+	}
+	static bool scan_meta(const char*& it, const char* end, meta& m) {
+		const char* at = std::find(it, end, '@');
+		if (at == end || at + 1 == end || !std::isdigit(at[1])) return false;
+		m.tag.assign(it, at);
+		m.when = 0;
+		for (it = at + 1; it != end && std::isdigit(*it); it++) m.when = m.when * 10 + (*it - '0');
+		return true;
+	}
+
 	static board initial_state() {
 		return {};
 	}
@@ -193,6 +346,10 @@ protected:
 		auto now = std::chrono::system_clock::now().time_since_epoch();
 		return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
 	}
+	static time_t microsec() { // monotonic, for the time of the moves
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+	}
 
 private:
 	board ep_state;
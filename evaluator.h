@@ -0,0 +1,218 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * evaluator.h: Define the interface of the leaf evaluators (e.g., neural networks) and their batching
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdexcept>
+#include "board.h"
+#include "playout.h"
+
+/**
+ * the value and the policy of positions, evaluated in batches, e.g., by the inference of a network
+ *
+ * each position is given as the board and its input planes, see encode(), so that a network backend only
+ * reads the planes, while other backends may work on the boards directly
+ * the backends are registered by name in backends(), and created by create(), e.g., for the "eval=" option
+ */
+class evaluator {
+public:
+	enum { cells = board::size_x * board::size_y };
+
+	/**
+	 * the input planes of a position, each of the cells in 1-d array style, from the view of the side to move
+	 *   0: the stones of the side to move     1: the stones of the opponent
+	 *   2: the empty cells                    3: the hollow cells
+	 *   4: the legal moves of the side to move  5: the legal moves of the opponent
+	 *   6: all ones if black is to move
+	 */
+	enum { channels = 7, plane_size = channels * cells };
+	typedef std::array<float, plane_size> planes;
+
+	/**
+	 * the value is the winning probability of the side to move, and the policy is the probability of each move
+	 */
+	struct result {
+		float value;
+		std::array<float, cells> policy;
+	};
+
+	virtual ~evaluator() {}
+
+	/**
+	 * evaluate n positions at once
+	 */
+	virtual void evaluate(const board* states, const planes* inputs, size_t n, result* results) = 0;
+
+	static void encode(const board& state, planes& p) {
+		unsigned who = state.info().who_take_turns, opp = 3u - who;
+		const bitboard masks[channels] = {
+			state.mask(who), state.mask(opp), state.mask(board::empty), state.mask(board::hollow),
+			state.legal_moves(who), state.legal_moves(opp), who == board::black ? board::cells() : bitboard()
+		};
+		for (unsigned c = 0; c < channels; c++)
+			for (unsigned i = 0; i < cells; i++) p[c * cells + i] = masks[c].test(i) ? 1 : 0;
+	}
+
+public:
+	typedef std::function<evaluator*(const std::string& args)> factory;
+	static std::map<std::string, factory>& backends() { static std::map<std::string, factory> m; return m; }
+
+	/**
+	 * create the backend of the given name with its arguments, throw if there is no such backend
+	 */
+	static std::unique_ptr<evaluator> create(const std::string& name, const std::string& args = "") {
+		auto backend = backends().find(name);
+		if (backend == backends().end()) throw std::invalid_argument("unknown evaluator: " + name);
+		return std::unique_ptr<evaluator>(backend->second(args));
+	}
+};
+
+/**
+ * the reference backend, which values a position by the random playouts in the SIMD lanes and gives a uniform policy
+ * the moves of a network are not needed, so that the batching and the search can be tested without any model
+ */
+class playout_evaluator : public evaluator {
+public:
+	playout_evaluator(uint64_t seed = 0) : rollout(seed) {}
+
+	void evaluate(const board* states, const planes* inputs, size_t n, result* results) {
+		for (size_t k = 0; k < n; k++) {
+			unsigned who = states[k].info().who_take_turns;
+			unsigned black_wins = __builtin_popcount(rollout.run(states[k], batch_playout::lanes));
+			unsigned wins = who == board::black ? black_wins : batch_playout::lanes - black_wins;
+			results[k].value = float(wins) / batch_playout::lanes;
+			bitboard moves = states[k].legal_moves(who);
+			float uniform = moves ? 1.0f / moves.count() : 0;
+			for (unsigned i = 0; i < cells; i++) results[k].policy[i] = moves.test(i) ? uniform : 0;
+		}
+	}
+
+private:
+	batch_playout rollout;
+	static __attribute__((constructor)) void init() {
+		backends()["playout"] = [](const std::string& args) { return new playout_evaluator(std::hash<std::string>()(args)); };
+	}
+};
+
+/**
+ * gather the leaves of several search threads into batches for a backend, which runs on its own thread
+ *
+ * a batch is sent to the backend as soon as it is full, or as soon as every attached thread is waiting for its leaf,
+ * or when the oldest leaf has waited longer than the given time, so that a single thread never waits for the others
+ * with tree parallelism, the virtual losses keep the waiting threads on different leaves
+ */
+class batch_evaluator {
+public:
+	batch_evaluator(std::unique_ptr<evaluator> backend, size_t batch, std::chrono::microseconds wait)
+		: backend(std::move(backend)), batch(std::max(batch, size_t(1))), wait(wait), clients(0), closing(false) {
+		worker = std::thread(&batch_evaluator::serve, this);
+	}
+	~batch_evaluator() {
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			closing = true;
+		}
+		ready.notify_all();
+		worker.join();
+	}
+
+	batch_evaluator(const batch_evaluator&) = delete;
+	batch_evaluator& operator =(const batch_evaluator&) = delete;
+
+	/**
+	 * register a search thread before it evaluates any leaf, and unregister it after its last one
+	 */
+	void attach() {
+		std::lock_guard<std::mutex> guard(mutex);
+		clients++;
+	}
+	void detach() {
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			clients--;
+		}
+		ready.notify_all();
+	}
+
+	/**
+	 * evaluate a leaf by the backend, and wait until its batch is done
+	 */
+	evaluator::result evaluate(const board& state) {
+		request req(state);
+		evaluator::encode(state, req.input);
+		std::unique_lock<std::mutex> lock(mutex);
+		queue.push_back(&req);
+		ready.notify_all();
+		done.wait(lock, [&]() { return req.done; });
+		return req.output;
+	}
+
+private:
+	struct request {
+		request(const board& state) : state(state), arrived(std::chrono::steady_clock::now()), done(false) {}
+		board state;
+		std::chrono::steady_clock::time_point arrived;
+		evaluator::planes input;
+		evaluator::result output;
+		bool done;
+	};
+
+	void serve() {
+		std::vector<request*> taken;
+		std::vector<board> states;
+		std::vector<evaluator::planes> inputs;
+		std::vector<evaluator::result> outputs;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			auto full = [&]() { return queue.size() >= batch || (queue.size() && queue.size() >= clients); };
+			ready.wait(lock, [&]() { return closing || queue.size(); });
+			if (queue.empty()) break;
+			// a batch waits for at most the wait from the arrival of its oldest leaf, including the leaves left by the last batch
+			ready.wait_until(lock, queue.front()->arrived + wait, [&]() { return closing || full(); });
+			size_t n = std::min(queue.size(), batch);
+			taken.assign(queue.begin(), queue.begin() + n);
+			queue.erase(queue.begin(), queue.begin() + n);
+			lock.unlock();
+			states.clear();
+			inputs.clear();
+			for (request* req : taken) {
+				states.push_back(req->state);
+				inputs.push_back(req->input);
+			}
+			outputs.resize(n);
+			backend->evaluate(states.data(), inputs.data(), n, outputs.data());
+			lock.lock();
+			for (size_t k = 0; k < n; k++) {
+				taken[k]->output = outputs[k];
+				taken[k]->done = true;
+			}
+			done.notify_all();
+		}
+	}
+
+private:
+	std::unique_ptr<evaluator> backend;
+	size_t batch;
+	std::chrono::microseconds wait;
+	size_t clients;
+	bool closing;
+	std::vector<request*> queue;
+	std::mutex mutex;
+	std::condition_variable ready, done;
+	std::thread worker;
+};
@@ -0,0 +1,162 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * gtp.h: Asynchronous I/O of the commands and the responses of the GTP shell
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <unistd.h>
+#include <sys/select.h>
+
+/**
+ * the commands are read from the input on a background thread, so that a long command (e.g., a search)
+ * can be interrupted as soon as the following commands arrive, see the arrived callback
+ * each response is written by a single system call, i.e., buffered as a whole but flushed at once
+ *
+ * the lines are preprocessed as GTP, i.e., the control characters are removed, the tabs are taken as spaces,
+ * the comments after '#' and the empty lines are ignored, and the optional numeric id is kept for the response
+ */
+class gtp_io {
+public:
+	struct command {
+		std::string id;
+		std::vector<std::string> args; // the command name followed by its arguments, never empty
+	};
+
+	/**
+	 * read the commands from the input, the arrived callback is called on the reader thread
+	 * right after each command is queued, e.g., to interrupt the running command
+	 */
+	gtp_io(int in = 0, int out = 1, std::function<void(const command&)> arrived = nullptr)
+		: in(in), out(out), arrived(arrived), closed(false) {
+		if (::pipe(wakeup) != 0) wakeup[0] = wakeup[1] = -1;
+		reader = std::thread(&gtp_io::read, this);
+	}
+	~gtp_io() {
+		if (wakeup[1] >= 0 && ::write(wakeup[1], "", 1) < 0) {}
+		reader.join();
+		if (wakeup[0] >= 0) ::close(wakeup[0]), ::close(wakeup[1]);
+	}
+
+	gtp_io(const gtp_io&) = delete;
+	gtp_io& operator =(const gtp_io&) = delete;
+
+	/**
+	 * wait for the next command, return false at the end of the input
+	 */
+	bool next(command& cmd) {
+		std::unique_lock<std::mutex> lock(mutex);
+		ready.wait(lock, [this]() { return queue.size() || closed; });
+		if (queue.empty()) return false;
+		cmd = std::move(queue.front());
+		queue.pop_front();
+		return true;
+	}
+
+	/**
+	 * whether a command is waiting, or the input is closed, i.e., the running command should finish
+	 */
+	bool pending() {
+		std::lock_guard<std::mutex> guard(mutex);
+		return queue.size() || closed;
+	}
+
+	/**
+	 * respond to the command, e.g., "=12 E5" followed by an empty line
+	 */
+	void reply(const command& cmd, const std::string& text, bool success = true) {
+		write((success ? "=" : "?") + cmd.id + " " + text + "\n\n");
+	}
+
+	/**
+	 * write the text and flush at once, e.g., for the partial responses of an analysis
+	 */
+	void write(const std::string& text) {
+		std::lock_guard<std::mutex> guard(output);
+		for (size_t done = 0; done < text.size(); ) {
+			ssize_t n = ::write(out, text.data() + done, text.size() - done);
+			if (n <= 0) break;
+			done += n;
+		}
+	}
+
+private:
+	void read() {
+		std::string buf;
+		char chunk[4096];
+		while (true) {
+			if (wakeup[0] >= 0) { // wait for either the input or the destructor
+				fd_set fds;
+				FD_ZERO(&fds);
+				FD_SET(in, &fds);
+				FD_SET(wakeup[0], &fds);
+				if (::select(std::max(in, wakeup[0]) + 1, &fds, nullptr, nullptr, nullptr) < 0) continue;
+				if (FD_ISSET(wakeup[0], &fds)) break;
+			}
+			ssize_t n = ::read(in, chunk, sizeof(chunk));
+			if (n <= 0) break;
+			buf.append(chunk, n);
+			size_t begin = 0;
+			for (size_t eol; (eol = buf.find('\n', begin)) != std::string::npos; begin = eol + 1)
+				push(buf.substr(begin, eol - begin));
+			buf.erase(0, begin);
+		}
+		if (buf.size()) push(buf);
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			closed = true;
+		}
+		ready.notify_all();
+		if (arrived) arrived(command{ "", { "" } }); // the end of the input
+	}
+
+	void push(const std::string& line) {
+		command cmd;
+		std::string token;
+		for (char c : line) {
+			if (c == '#') break;
+			if (c == '\t') c = ' ';
+			if (std::iscntrl(static_cast<unsigned char>(c))) continue;
+			if (c != ' ') {
+				token += c;
+			} else if (token.size()) {
+				cmd.args.push_back(std::move(token));
+				token.clear();
+			}
+		}
+		if (token.size()) cmd.args.push_back(std::move(token));
+		if (cmd.args.size() && std::all_of(cmd.args[0].begin(), cmd.args[0].end(), ::isdigit)) {
+			cmd.id = cmd.args[0];
+			cmd.args.erase(cmd.args.begin());
+		}
+		if (cmd.args.empty()) return;
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			queue.push_back(cmd);
+		}
+		ready.notify_all();
+		if (arrived) arrived(cmd);
+	}
+
+private:
+	int in, out;
+	int wakeup[2];
+	std::function<void(const command&)> arrived;
+	bool closed;
+	std::deque<command> queue;
+	std::mutex mutex, output;
+	std::condition_variable ready;
+	std::thread reader;
+};
@@ -0,0 +1,717 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * mcts.h: Define the tree and the search routine of Monte-Carlo tree search
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <array>
+#include <vector>
+#include <unordered_set>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+#include <cmath>
+#include "board.h"
+#include "action.h"
+#include "transposition.h"
+#include "playout.h"
+#include "evaluator.h"
+#include "solver.h"
+
+/**
+ * lookup tables of log(n) and 1/sqrt(n) for the visit counts used by UCT
+ * counts beyond the table are computed directly
+ */
+class UCTtable
+{
+public:
+	enum { size = 1 << 16 };
+	static float log(int n) { return n < size ? table().log_n[n] : std::log(float(n)); }
+	static float rsqrt(int n) { return n < size ? table().rsqrt_n[n] : 1 / std::sqrt(float(n)); }
+
+private:
+	UCTtable()
+	{
+		log_n[0] = rsqrt_n[0] = 0;
+		for (int n = 1; n < size; n++)
+		{
+			log_n[n] = std::log(float(n));
+			rsqrt_n[n] = 1 / std::sqrt(float(n));
+		}
+	}
+	static const UCTtable &table()
+	{
+		static UCTtable t;
+		return t;
+	}
+	static __attribute__((constructor)) void init() { table(); }
+
+	std::array<float, size> log_n, rsqrt_n;
+};
+
+/**
+ * node of the search tree
+ * the counters are atomic so that several threads can search the same tree
+ */
+class Node
+{
+public:
+	Node() {}
+	Node(const Node &n) { *this = n; }
+	Node &operator=(const Node &n)
+	{
+		parent = n.parent;
+		first_child = n.first_child;
+		child_count.store(n.child_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		position = n.position;
+		placer = n.placer;
+		win.store(n.win.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		games.store(n.games.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		hash = n.hash;
+		proven.store(n.proven.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		amaf.store(n.amaf.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		return *this;
+	}
+	int parent = -1;
+	int first_child = -1; // the children are stored contiguously in the pool
+	std::atomic<int> win{0}, games{0};
+	uint64_t hash = 0; // the hash of the board after the move
+	std::atomic<int8_t> child_count{0}; // -1 while a thread is expanding the node, at most 121 children of 11x11
+	std::atomic<int8_t> proven{0}; // 1 if the placer is proven to win, -1 if proven to lose, or 0 if unknown
+	int8_t position = -1;
+	uint8_t placer = board::black;
+	std::atomic<uint32_t> amaf{0}; // the all-moves-as-first statistics of the move, packed as (win << 16) | games
+
+public:
+	bool isleaf() const
+	{
+		return child_count.load(std::memory_order_acquire) <= 0;
+	}
+	int8_t solved() const
+	{
+		return proven.load(std::memory_order_relaxed);
+	}
+	/**
+	 * the UCT value given the exploration factor c * sqrt(log(N)) of the parent
+	 * if the statistics of the position are shared by transpositions, the win rate is taken
+	 * from the shared entry when it has more games than the node
+	 */
+	float UCTvalue(float exploration, const TranspositionTable::Entry *shared = nullptr) const
+	{
+		int n = games.load(std::memory_order_relaxed);
+		// the case that the node is unvisited
+		if (n == 0)
+		{
+			return FLT_MAX;
+		}
+		// common case
+		float rate = (float)win.load(std::memory_order_relaxed) / n;
+		if (shared)
+		{
+			int m = shared->games.load(std::memory_order_relaxed);
+			if (m > n)
+				rate = (float)shared->win.load(std::memory_order_relaxed) / m;
+		}
+		return rate + exploration * UCTtable::rsqrt(n);
+	}
+	/**
+	 * the RAVE value, which blends the win rate with the all-moves-as-first rate by the weight
+	 * beta = sqrt(k / (3n + k)), where the equivalence k is the number of games at which both rates count equally
+	 * an unvisited node with AMAF statistics is valued by them alone, instead of always being the first choice
+	 */
+	float RAVEvalue(float exploration, float equivalence, const TranspositionTable::Entry *shared = nullptr) const
+	{
+		int n = games.load(std::memory_order_relaxed);
+		uint32_t packed = amaf.load(std::memory_order_relaxed);
+		int m = packed & 0xffff;
+		if (n == 0 && m == 0)
+		{
+			return FLT_MAX;
+		}
+		float rate = n ? (float)win.load(std::memory_order_relaxed) / n : 0;
+		if (shared)
+		{
+			int t = shared->games.load(std::memory_order_relaxed);
+			if (t > n)
+				rate = (float)shared->win.load(std::memory_order_relaxed) / t;
+		}
+		float amaf_rate = m ? (float)(packed >> 16) / m : rate;
+		float beta = std::sqrt(equivalence / (3 * n + equivalence));
+		return (1 - beta) * rate + beta * amaf_rate + exploration * UCTtable::rsqrt(std::max(n, 1));
+	}
+	/**
+	 * add the AMAF results of the move, the counters stop growing near 65536 games so that they never overflow
+	 */
+	void add_amaf(int win, int games)
+	{
+		if ((amaf.load(std::memory_order_relaxed) & 0xffff) < amaf_limit)
+			amaf.fetch_add((uint32_t(win) << 16) | uint32_t(games), std::memory_order_relaxed);
+	}
+	static constexpr uint32_t amaf_limit = 0xffff - 0x1000; // leave room for the racing updates
+	action::place move() const
+	{
+		return action::place(position, placer);
+	}
+	action::place GetBestMove(const Node *children) const
+	{
+		const Node *best = children;
+		for (const Node *child = children + 1; child < children + child_count; child++)
+		{
+			if (child->games > best->games)
+				best = child;
+		}
+		return best->move();
+	}
+};
+
+/**
+ * arena of the search tree nodes, referred by their indices
+ * the whole tree is released in O(1) by clear(), while the storage is kept for the next search
+ * the pool never holds more nodes than its limit, so that a search without a budget cannot exhaust the memory
+ */
+class NodePool
+{
+public:
+	Node &operator[](int i) { return nodes[i]; }
+	const Node &operator[](int i) const { return nodes[i]; }
+	size_t size() const { return std::min(used.load(std::memory_order_relaxed), nodes.size()); }
+	size_t capacity() const { return nodes.size(); }
+	void clear() { used = 0; }
+	void reserve(size_t n)
+	{
+		n = std::min(n, limit);
+		if (nodes.size() < n)
+			nodes.resize(n);
+	}
+	/**
+	 * set the most nodes that the pool may hold, at least the root
+	 */
+	void set_limit(size_t n) { limit = std::max(n, size_t(1)); }
+	/**
+	 * allocate n contiguous nodes, return the index of the first one, or -1 if the pool is full
+	 * the storage grows (up to the limit) only if grow is set, in which case the references to the nodes are invalidated;
+	 * without growing, several threads may allocate concurrently
+	 */
+	int allocate(int n, bool grow = true)
+	{
+		size_t first = used.fetch_add(n, std::memory_order_relaxed);
+		if (first + n > nodes.size())
+		{
+			if (!grow || first + n > limit)
+				return -1;
+			nodes.resize(std::min(std::max(nodes.size() * 2, first + n), limit));
+		}
+		std::fill(nodes.begin() + first, nodes.begin() + first + n, Node());
+		return first;
+	}
+
+	/**
+	 * keep only the subtree under the given node and release all the others
+	 * the subtree is compacted to the front of the pool in breadth-first order, with the children
+	 * of each node still stored contiguously; return the index of the new root, i.e., 0
+	 */
+	int retain(int node)
+	{
+		std::vector<Node> kept(1, nodes[node]);
+		kept[0].parent = -1;
+		for (size_t i = 0; i < kept.size(); i++)
+		{
+			int count = std::max(int(kept[i].child_count), 0);
+			int first = kept[i].first_child;
+			kept[i].child_count = count;
+			kept[i].first_child = count ? kept.size() : -1;
+			for (int k = 0; k < count; k++)
+			{
+				kept.push_back(nodes[first + k]);
+				kept.back().parent = i;
+			}
+		}
+		std::copy(kept.begin(), kept.end(), nodes.begin());
+		used = kept.size();
+		return 0;
+	}
+
+private:
+	std::vector<Node> nodes;
+	std::atomic<size_t> used{0};
+	size_t limit = SIZE_MAX;
+};
+
+/**
+ * the budget of a search, shared by all of its threads
+ * the search stops when the iterations run out, the deadline passes, or stop() is called
+ */
+class SearchLimit
+{
+public:
+	SearchLimit(int iterations, const std::chrono::steady_clock::time_point *deadline = nullptr)
+		: remaining(iterations), timed(deadline != nullptr), stopped(false)
+	{
+		if (timed)
+			this->deadline = *deadline;
+	}
+	/**
+	 * whether a thread may run its i-th iteration, the clock is checked every clock_interval iterations
+	 */
+	bool next(int i)
+	{
+		if (stopped.load(std::memory_order_relaxed))
+			return false;
+		if (timed && i % clock_interval == clock_interval - 1 && std::chrono::steady_clock::now() >= deadline)
+		{
+			stop();
+			return false;
+		}
+		return remaining.fetch_sub(1, std::memory_order_relaxed) > 0;
+	}
+	void stop() { stopped.store(true, std::memory_order_relaxed); }
+
+private:
+	static constexpr int clock_interval = 16;
+	std::atomic<int> remaining;
+	bool timed;
+	std::chrono::steady_clock::time_point deadline;
+	std::atomic<bool> stopped;
+};
+
+/**
+ * a single thread of Monte-Carlo tree search on a NodePool, playing for who
+ * several searches may share a pool (tree parallelism), in which case the visits are counted
+ * during the selection as virtual losses, and the pool does not grow
+ */
+class MCTS
+{
+public:
+	/**
+	 * with symmetric, only one move of each group of symmetric moves is expanded, and the nodes
+	 * are hashed by the canonical hash so that the symmetric positions share the table entries
+	 * each leaf is evaluated by batch (1 ~ batch_playout::lanes) playouts
+	 * with rave > 0, the children are selected by RAVE with the equivalence parameter rave, see Node::RAVEvalue
+	 * with widen > 0, the children are created progressively in the order of prior(), see width()
+	 * with network, each leaf is evaluated by the network instead of the playouts, and its policy orders the children,
+	 * while RAVE is disabled since there are no playouts
+	 * with solver, each leaf with at most solve legal moves is solved within solve_nodes nodes when it is expanded,
+	 * and the proven nodes are propagated up the tree and never searched again, see prove(), while the proofs
+	 * in the tree are ignored without solver
+	 */
+	MCTS(NodePool &tree, batch_playout &rollout, board::piece_type who, bool shared = false,
+		 TranspositionTable *table = nullptr, bool symmetric = false, int batch = 1, float rave = 0, int widen = 0,
+		 batch_evaluator *network = nullptr, Solver *solver = nullptr, int solve = 0, size_t solve_nodes = 0)
+		: tree(tree), rollout(rollout), who(who), shared(shared), table(table), symmetric(symmetric), batch(batch),
+		  rave(network ? 0 : rave), widen(shared ? 0 : widen), network(network), solver(solver), solve(solve),
+		  solve_nodes(solve_nodes) {}
+
+	/**
+	 * create the root of a new tree in the pool, for searching the moves of who at the given state
+	 */
+	static int create_root(NodePool &tree, board::piece_type who, const board &state, bool symmetric = false)
+	{
+		int root = tree.allocate(1);
+		tree[root].hash = symmetric ? state.canonical_hash() : state.hash();
+		// decide the placer of root
+		if (who == board::black)
+		{
+			tree[root].placer = board::white;
+		}
+		else
+		{
+			tree[root].placer = board::black;
+		}
+		return root;
+	}
+
+	/**
+	 * run iterations from the root until the limit is reached, return the number of iterations
+	 */
+	int run(const board &state, int root, SearchLimit &limit)
+	{
+		if (network)
+			network->attach();
+		int i = 0;
+		for (; limit.next(i); i++)
+		{
+			// a fresh copy per iteration rather than make/unmake, since the playout runs on it in place to the end
+			board current_board(state);
+			// select
+			int current_node = selection(current_board, root);
+			if (solver && tree[current_node].solved())
+			{
+				// a proven node is neither expanded nor simulated, but counted by its result, without any playout for AMAF
+				backpropagation(current_node, proven_win(current_node), false);
+				if (tree[root].solved())
+					limit.stop();
+				continue;
+			}
+			// with a network, the leaf is evaluated first, so that its policy is ready for the expansion
+			int win = network ? evaluation(current_board) : 0;
+			// expand
+			if (tree[current_node].games > (shared ? 1 : 0))
+			{
+				expansion(current_board, current_node);
+			}
+			// simulate
+			if (!network)
+				win = simulation(current_board);
+			// backpropagation
+			backpropagation(current_node, win);
+		}
+		if (network)
+			network->detach();
+		return i;
+	}
+
+	/**
+	 * the maximum depth of the selections so far, i.e., the plies from the root to the deepest leaf
+	 */
+	int max_depth() const { return deepest; }
+
+public:
+	int selection(board &state, int root)
+	{
+		// selection
+		int node = root, depth = 0;
+		if (shared)
+			tree[node].games++; // virtual loss
+		while (!tree[node].isleaf() && !(solver && tree[node].solved()))
+		{
+			node = selectchild(state, node);
+			if (shared)
+				tree[node].games++;
+			depth++;
+		}
+		deepest = std::max(deepest, depth);
+		return node;
+	}
+	void expansion(board &state, int node)
+	{
+		// expansion
+		// claim the node first, so that a node is never expanded twice by different threads
+		int8_t unexpanded = 0;
+		if (!tree[node].child_count.compare_exchange_strong(unexpanded, -1))
+			return;
+		if (solver && settle(state, node))
+		{
+			tree[node].child_count.store(0, std::memory_order_release);
+			return;
+		}
+		std::array<int, board::size_x * board::size_y> moves;
+		int count = candidates(state, bitboard(), moves);
+		if (widen && count <= widen)
+			exhausted.insert(node);
+		if (widen)
+			count = std::min(count, widen);
+		int first = count ? tree.allocate(count, !shared) : -1;
+		if (first == -1)
+		{
+			tree[node].child_count.store(0, std::memory_order_release);
+			return;
+		}
+		create_children(state, node, first, moves.data(), count);
+		tree[node].first_child = first;
+		tree[node].child_count.store(count, std::memory_order_release);
+	}
+	/**
+	 * try to prove the node before its expansion, i.e., the side to move has lost if it has no legal move,
+	 * or the node is solved if the side to move has at most solve legal moves (unless solve_nodes is 0),
+	 * return whether the node is proven
+	 */
+	bool settle(board &state, int node)
+	{
+		int count = state.legal_moves(state.info().who_take_turns).count();
+		int result = count ? 0 : -1;
+		if (count && count <= solve && solve_nodes)
+			result = solver->solve(state, solve_nodes);
+		if (!result)
+			return false;
+		tree[node].proven.store(-result, std::memory_order_relaxed);
+		prove(node);
+		return true;
+	}
+	/**
+	 * propagate the proof of the node to its ancestors, i.e., a move proven to win for the side to move proves
+	 * its parent lost for the placer of the parent, and the parent is proven won once all of its moves are lost,
+	 * which is unknown under progressive widening since the moves not yet created may win
+	 */
+	void prove(int node)
+	{
+		for (int parent = tree[node].parent; parent != -1; node = parent, parent = tree[node].parent)
+		{
+			if (tree[node].solved() < 0)
+			{
+				int child_count = tree[parent].child_count.load(std::memory_order_acquire);
+				if (widen || child_count <= 0)
+					return;
+				for (int child = tree[parent].first_child; child < tree[parent].first_child + child_count; child++)
+				{
+					if (tree[child].solved() >= 0)
+						return;
+				}
+			}
+			tree[parent].proven.store(-tree[node].solved(), std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * the number of the batch games won by who at a proven node
+	 */
+	int proven_win(int node) const
+	{
+		bool placer_wins = tree[node].solved() > 0;
+		return placer_wins == (tree[node].placer == who) ? batch : 0;
+	}
+	/**
+	 * the number of children of a node with n visits under progressive widening,
+	 * which doubles each time the visits are quadrupled, i.e., grows as sqrt(n), starting from widen children
+	 */
+	int width(int n) const
+	{
+		int w = widen;
+		for (int step = 3 * widen; n >= step && w < board::size_x * board::size_y; step = 4 * step + 3 * widen)
+			w *= 2;
+		return w;
+	}
+	/**
+	 * add the next best moves to the children of a node, so that it has at most the given number of children
+	 * the children are moved to a new contiguous block together with the new ones, and the old block is left unused,
+	 * which is safe only if no other thread is walking the tree
+	 * a node that cannot get more children, i.e., all of its moves are children or the pool is full, is marked
+	 * as exhausted, so that its moves are not ranked again on every visit
+	 */
+	void widen_node(board &state, int node, int allowed)
+	{
+		int first = tree[node].first_child, count = tree[node].child_count;
+		bitboard existing;
+		for (int child = first; child < first + count; child++)
+			existing |= bitboard::bit(tree[child].position);
+		std::array<int, board::size_x * board::size_y> moves;
+		int left = candidates(state, existing, moves);
+		int added = std::min(left, allowed - count);
+		if (added == left)
+			exhausted.insert(node);
+		if (added <= 0)
+			return;
+		int moved = tree.allocate(count + added, true);
+		if (moved == -1)
+		{
+			exhausted.insert(node);
+			return;
+		}
+		for (int k = 0; k < count; k++)
+		{
+			Node &child = tree[moved + k];
+			child = tree[first + k];
+			for (int grandchild = child.first_child; grandchild < child.first_child + child.child_count; grandchild++)
+				tree[grandchild].parent = moved + k;
+		}
+		create_children(state, node, moved + count, moves.data(), added);
+		tree[node].first_child = moved;
+		tree[node].child_count.store(count + added, std::memory_order_release);
+	}
+	/**
+	 * collect the legal moves of the side to move except the excluded ones, skipping the moves symmetric to a smaller one
+	 * the moves are in random order, or sorted by prior() (with random ties) if the children are widened progressively,
+	 * or sorted by the policy of the network (evaluated at the same state) if any
+	 * return the number of moves
+	 */
+	int candidates(board &state, const bitboard &exclude, std::array<int, board::size_x * board::size_y> &moves)
+	{
+		board::piece_type turn = state.info().who_take_turns;
+		int count = 0;
+		unsigned same = symmetric ? state.symmetries() : 1;
+		for (int i : state.legal_moves(turn) & ~exclude)
+		{
+			bool smallest = true;
+			for (int s = 1; s < 8 && smallest; s++)
+				smallest = !(same & (1u << s)) || board::symmetric(i, s) >= i;
+			if (smallest)
+				moves[count++] = i;
+		}
+		std::shuffle(moves.begin(), moves.begin() + count, rollout.engine());
+		if (widen || network)
+		{
+			std::array<std::pair<float, int>, board::size_x * board::size_y> ranked;
+			for (int k = 0; k < count; k++)
+				ranked[k] = std::make_pair(network ? -evaluated.policy[moves[k]] : -prior(state, moves[k]), k);
+			std::sort(ranked.begin(), ranked.begin() + count);
+			std::array<int, board::size_x * board::size_y> shuffled = moves;
+			for (int k = 0; k < count; k++)
+				moves[k] = shuffled[ranked[k].second];
+		}
+		return count;
+	}
+	/**
+	 * the cheap prior of the move at i for the side to move, i.e., the difference between the legal moves
+	 * of the mover and of the opponent after the move, since a NoGo game is lost by running out of legal moves
+	 */
+	static int prior(board &state, int i)
+	{
+		board::piece_type turn = state.info().who_take_turns;
+		board::undo u = state.make(i);
+		int mobility = int(state.legal_moves(turn).count()) - int(state.legal_moves(board::piece_type(3 - turn)).count());
+		state.unmake(u);
+		return mobility;
+	}
+	void create_children(const board &state, int node, int first, const int *moves, int count)
+	{
+		board::piece_type turn = state.info().who_take_turns;
+		std::array<uint64_t, 8> hashes;
+		if (symmetric)
+			hashes = state.symmetric_hashes();
+		for (int k = 0; k < count; k++)
+		{
+			Node &newnode = tree[first + k];
+			newnode.position = moves[k];
+			newnode.parent = node;
+			newnode.hash = symmetric ? board::canonical_hash_after(hashes, moves[k], turn) : state.hash_after(moves[k], turn);
+			if (tree[node].placer == board::black)
+				newnode.placer = board::white;
+			else
+				newnode.placer = board::black;
+		}
+	}
+	int simulation(board &state)
+	{
+		// simulation
+		// return the number of the playouts won by who
+		// with RAVE, the results and the final stones of each playout are kept for the AMAF statistics
+		// the state is a scratch copy of the iteration, so that a single playout runs on it in place
+		if (batch == 1)
+			results = rollout.run_in_place(state, rave ? played.data() : nullptr);
+		else
+			results = rollout.run(state, batch, rave ? played.data() : nullptr);
+		int black_wins = __builtin_popcount(results);
+		return who == board::black ? black_wins : batch - black_wins;
+	}
+	/**
+	 * evaluate the leaf by the network, and keep the result for the expansion
+	 * return the value as the number of the batch games won by who, by rounding value * batch at random without bias
+	 */
+	int evaluation(board &state)
+	{
+		board::piece_type turn = state.info().who_take_turns;
+		if (is_terminal(state))
+			return turn == who ? 0 : batch; // the side to move has lost
+		evaluated = network->evaluate(state);
+		float value = turn == who ? evaluated.value : 1 - evaluated.value;
+		float wins = value * batch + float(rollout.engine()()) / 4294967296.0f;
+		return std::max(0, std::min(int(wins), batch));
+	}
+	void backpropagation(int node, int win, bool amaf = true)
+	{
+		// each node counts the wins of its placer, so that the selection at every level
+		// maximizes the win rate of the side to move
+		// the virtual loss of the shared tree has already counted one of the games
+		// the AMAF results are added only if the win is of the playouts just simulated
+		int games = shared ? batch - 1 : batch;
+		while (node != -1)
+		{
+			int placer_win = tree[node].placer == who ? win : batch - win;
+			if (games)
+				tree[node].games += games;
+			if (placer_win)
+				tree[node].win += placer_win;
+			TranspositionTable::Entry *entry = table ? table->insert(tree[node].hash) : nullptr;
+			if (entry)
+			{
+				entry->games.fetch_add(batch, std::memory_order_relaxed);
+				if (placer_win)
+					entry->win.fetch_add(placer_win, std::memory_order_relaxed);
+			}
+			if (rave && amaf)
+				update_amaf(node);
+			node = tree[node].parent;
+		}
+	}
+	/**
+	 * add the AMAF results to each child of the node, i.e., the playouts in which the placer of the child
+	 * played its move at any later time, either in the tree below the node or in the playout
+	 * since the stones stay, these are the playouts whose final stones of the placer contain the move
+	 */
+	void update_amaf(int node)
+	{
+		int child_count = tree[node].child_count.load(std::memory_order_acquire);
+		if (child_count <= 0)
+			return;
+		for (int child = tree[node].first_child; child < tree[node].first_child + child_count; child++)
+		{
+			Node &c = tree[child];
+			int games = 0, win = 0;
+			for (int k = 0; k < batch; k++)
+			{
+				if (!played[k][c.placer - 1].test(c.position))
+					continue;
+				games++;
+				if (((results >> k) & 1u) == (c.placer == board::black))
+					win++;
+			}
+			if (games)
+				c.add_amaf(win, games);
+		}
+	}
+
+public:
+	int selectchild(board &state, int node)
+	{
+		if (widen && tree[node].child_count > 0 && width(tree[node].games) > tree[node].child_count && !exhausted.count(node))
+			widen_node(state, node, width(tree[node].games));
+		const Node &parent = tree[node];
+		int child_count = parent.child_count.load(std::memory_order_acquire);
+		if (child_count <= 0)
+		{
+			return -1;
+		}
+		// find the largest UCT child in a single pass, log(N) of the parent is shared by all children
+		float exploration = float(sqrt(2)) * sqrt(UCTtable::log(parent.games));
+		int best_child = parent.first_child;
+		float best_value = -FLT_MAX;
+		for (int child = parent.first_child; child < parent.first_child + child_count; child++)
+		{
+			const TranspositionTable::Entry *shared = table ? table->probe(tree[child].hash) : nullptr;
+			float value = rave ? tree[child].RAVEvalue(exploration, rave, shared) : tree[child].UCTvalue(exploration, shared);
+			if (solver && tree[child].solved())
+				value = tree[child].solved() > 0 ? FLT_MAX : -FLT_MAX; // always take a winning move, never a losing one
+			if (value > best_value)
+			{
+				best_value = value;
+				best_child = child;
+				if (value == FLT_MAX)
+					break; // an unvisited child is always the first choice
+			}
+		}
+		// place the move of the largest UCT child, which is legal since the children are created from the legal moves
+		state.play(tree[best_child].position);
+		// return the node with largest UCT value
+		return best_child;
+	}
+	bool is_terminal(const board &cur_state)
+	{
+		return !cur_state.legal_moves(cur_state.info().who_take_turns);
+	}
+
+private:
+	NodePool &tree;
+	batch_playout &rollout;
+	board::piece_type who;
+	bool shared;
+	TranspositionTable *table;
+	bool symmetric;
+	int batch;
+	float rave;
+	int widen;
+	batch_evaluator *network;
+	Solver *solver;
+	int solve;
+	size_t solve_nodes;
+	evaluator::result evaluated;
+	unsigned results = 0;
+	std::array<batch_playout::stones, batch_playout::lanes> played;
+	int deepest = 0;
+	std::unordered_set<int> exhausted; // the nodes that cannot be widened any more, see widen_node()
+};
@@ -11,20 +11,32 @@
 #include <fstream>
 #include <iterator>
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include <atomic>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 #include "episode.h"
 #include "statistics.h"
+#include "gtp.h"
+#include "remote.h"
 
 int main(int argc, const char* argv[]) {
 	std::cout << "HollowNoGo-Demo: ";
 	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
 	std::cout << std::endl << std::endl;
 
-	size_t total = 1000, block = 0, limit = 0;
+	size_t total = 1000, block = 0, limit = 0, workers = 1;
 	std::string black_args, white_args;
 	std::string load_path, save_path;
+	size_t save_flush = 1;
+	bool save_async = false, save_counters = false;
+	std::string book_path;
+	size_t book_depth = 10, book_min = 2;
+	std::string serve_address, serve_key, worker_address;
+	int serve_timeout = 600000;
 	std::string name = "TCG-HollowNoGo-Demo", version = "2022"; // for GTP shell
 	bool shell = false;
 	for (int i = 1; i < argc; i++) {
@@ -43,14 +55,36 @@ int main(int argc, const char* argv[]) {
 			block = std::stoull(next_opt());
 		} else if (match_arg("limit")) {
 			limit = std::stoull(next_opt());
+		} else if (match_arg("workers")) {
+			workers = std::stoull(next_opt());
 		} else if (match_arg("black")) {
 			black_args = next_opt();
 		} else if (match_arg("white")) {
 			white_args = next_opt();
 		} else if (match_arg("load")) {
 			load_path = next_opt();
+		} else if (match_arg("save-flush")) {
+			save_flush = std::stoull(next_opt());
+		} else if (match_arg("save-async")) {
+			save_async = true;
+		} else if (match_arg("save-counters")) {
+			save_counters = true;
 		} else if (match_arg("save")) {
 			save_path = next_opt();
+		} else if (match_arg("book-depth")) {
+			book_depth = std::stoull(next_opt());
+		} else if (match_arg("book-min")) {
+			book_min = std::stoull(next_opt());
+		} else if (match_arg("book")) {
+			book_path = next_opt();
+		} else if (match_arg("serve-timeout")) {
+			serve_timeout = std::stoi(next_opt());
+		} else if (match_arg("serve-key")) {
+			serve_key = next_opt();
+		} else if (match_arg("serve")) {
+			serve_address = next_opt();
+		} else if (match_arg("worker")) {
+			worker_address = next_opt();
 		} else if (match_arg("name")) {
 			name = next_opt();
 		} else if (match_arg("version")) {
@@ -60,49 +94,135 @@ int main(int argc, const char* argv[]) {
 		}
 	}
 
+	if (serve_address.empty()) workers = std::max(workers, size_t(1)); // no local worker is needed only if serving
+
+	if (worker_address.size()) { // serve the games and the searches of a coordinator, on parallel connections
+		std::atomic<size_t> served(0);
+		std::vector<std::thread> threads;
+		for (size_t k = 0; k < workers; k++)
+			threads.emplace_back([&]() { served += remote::worker(worker_address, serve_key).serve(); });
+		for (std::thread& thread : threads) thread.join();
+		std::cerr << "worker: " << served << " jobs served for " << worker_address << std::endl;
+		return 0;
+	}
+
 	statistics stats(total, block, limit);
+	// the opening book is built from all the loaded and the played episodes, and saved at exit
+	opening_book::builder book(book_depth);
+	if (book_path.size()) stats.collect(&book);
+
+	// the records are streamed to the save file as soon as each game finishes, including the loaded ones,
+	// and the new records are appended if the games are loaded from the same file,
+	// unless only the last limit records are kept and saved at exit
+	if (save_path.size() && !limit && save_path != load_path) stats.record(save_path, false, save_flush, save_async, save_counters);
 
 	if (load_path.size()) {
-		std::ifstream in(load_path, std::ios::in);
-		in >> stats;
-		in.close();
+		stats.load(load_path);
 		if (stats.is_finished()) stats.summary();
 	}
 
+	if (save_path.size() && !limit && save_path == load_path) stats.record(save_path, true, save_flush, save_async, save_counters);
+
 	MCTSplayer black("name=black " + black_args + " role=black");
 	MCTSplayer white("name=white " + white_args + " role=white");
 
-	if (!shell) { // launch standard local games
+	// the remote workers play the games along with the local workers, or help the searches of the shell
+	std::unique_ptr<remote::coordinator> server;
+	if (serve_address.size()) server.reset(new remote::coordinator(serve_address, serve_timeout, serve_key));
+
+	auto play = [](episode& game, agent& black, agent& white) -> agent& { // play until the game ends, return the winner
+		while (true) {
+			agent& who = game.take_turns(black, white);
+			action move = who.take_action(game.state());
+//			std::cerr << game.state() << "#" << game.step() << " " << who.name() << ": " << move << std::endl;
+			if (game.apply_action(move, who.counters()) != true) break;
+			if (who.check_for_win(game.state())) break;
+		}
+		return game.last_turns(black, white);
+	};
+
+	if (!shell && (workers > 1 || server)) { // launch local games on parallel workers, each with its own players
+		auto worker_args = [](const std::string& args, size_t k) -> std::string {
+			agent probe(args);
+			unsigned seed = std::default_random_engine::default_seed;
+			try { seed = std::stoul(probe.property("seed")); } catch (std::out_of_range&) {}
+			return args + " seed=" + std::to_string(seed + 1000003 * k);
+		};
+		std::string rejected;
+		if (server && !(remote::allowed(black_args, &rejected) && remote::allowed(white_args, &rejected))) {
+			std::cerr << "option " << rejected << " is not served to the workers" << std::endl;
+			return 1;
+		}
+		if (server) server->farm(stats, [&](size_t k) -> std::pair<std::string, std::string> {
+			return { "name=black " + worker_args(black_args, workers + k) + " role=black",
+			         "name=white " + worker_args(white_args, workers + k) + " role=white" };
+		});
+		auto worker = [&](agent& black, agent& white) {
+			while (true) {
+				if (!stats.reserve_episode()) {
+					// the games given up by the remote workers are reserved again, until all the games are merged
+					if (!server || stats.is_settled()) break;
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+					continue;
+				}
+				black.open_episode("~:" + white.name());
+				white.open_episode(black.name() + ":~");
+
+				episode game;
+				game.open_episode(black.name() + ":" + white.name());
+				agent& win = play(game, black, white);
+				game.close_episode(win.name());
+
+				black.close_episode(win.name());
+				white.close_episode(win.name());
+				stats.merge_episode(std::move(game));
+			}
+		};
+		std::vector<std::unique_ptr<agent>> players;
+		std::vector<std::thread> threads;
+		for (size_t k = 1; k < std::min(workers, total); k++) {
+			players.emplace_back(new MCTSplayer("name=black " + worker_args(black_args, k) + " role=black"));
+			players.emplace_back(new MCTSplayer("name=white " + worker_args(white_args, k) + " role=white"));
+			threads.emplace_back(worker, std::ref(*players[players.size() - 2]), std::ref(*players.back()));
+		}
+		if (workers) worker(black, white); // the first worker plays with the original players
+		while (!stats.is_settled()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		for (std::thread& thread : threads) thread.join();
+
+	} else if (!shell) { // launch standard local games
 		while (!stats.is_finished()) {
 //			std::cerr << "======== Game " << stats.step() << " ========" << std::endl;
 			black.open_episode("~:" + white.name());
 			white.open_episode(black.name() + ":~");
 
 			stats.open_episode(black.name() + ":" + white.name());
-			episode& game = stats.back();
-			while (true) {
-				agent& who = game.take_turns(black, white);
-				action move = who.take_action(game.state());
-//				std::cerr << game.state() << "#" << game.step() << " " << who.name() << ": " << move << std::endl;
-				if (game.apply_action(move) != true) break;
-				if (who.check_for_win(game.state())) break;
-			}
-			agent& win = game.last_turns(black, white);
+			agent& win = play(stats.back(), black, white);
 			stats.close_episode(win.name());
 
 			black.close_episode(win.name());
 			white.close_episode(win.name());
 		}
 	} else { // launch GTP shell
-		for (std::string command; std::getline(std::cin, command); ) {
-			if (command.back() == '\r') command.pop_back();
-			if (command.empty()) continue;
+		if (server) { // the root parallel searches of genmove are helped by the remote workers
+			black.help(server.get());
+			white.help(server.get());
+		}
+		// the commands are read on a background thread, so that a running search is interrupted
+		// by quit or clear_board, and an analysis runs until any next command arrives
+		std::atomic<bool> analyzing(false);
+		gtp_io io(0, 1, [&](const gtp_io::command& cmd) {
+			if (cmd.args[0] != "quit" && cmd.args[0] != "clear_board" && !analyzing) return;
+			black.interrupt();
+			white.interrupt();
+		});
+		for (gtp_io::command cmd; io.next(cmd); ) {
+			black.stop_pondering(); // the players may ponder until the next command arrives
+			white.stop_pondering();
 
-			std::vector<std::string> args;
-			std::istringstream iss(command);
-			for (std::string s; getline(iss, s, ' '); args.push_back(s));
+			const std::vector<std::string>& args = cmd.args;
 
 			std::string reply;
+			agent* ponder = nullptr;
 			if (args[0] == "play" || args[0] == "genmove") { // play a move, or generate a move and play
 				if (!stats.is_episode_ongoing()) { // should open an episode
 					black.open_episode("~:" + white.name());
@@ -112,8 +232,12 @@ int main(int argc, const char* argv[]) {
 
 				episode& game = stats.back();
 				agent& who = game.take_turns(black, white);
+				if (args.size() < 2 || (args[0] == "play" && args.size() < 3)) {
+					io.reply(cmd, "syntax error", false);
+					continue;
+				}
 				if (who.role()[0] != std::tolower(args[1][0])) { // player mismatch?!
-					std::cout << "= " << "resign" << std::endl << std::endl;
+					io.reply(cmd, "resign");
 					// show the error message and terminate the shell
 					std::cerr << "player color " << args[1] << " mismatch!" << std::endl;
 					std::cerr << "current state, "
@@ -124,7 +248,7 @@ int main(int argc, const char* argv[]) {
 					std::string types = "?bw"; // black == 1, white == 2
 					action::place move(args[2], types.find(who.role()[0]));
 					if (game.apply_action(move) != true) { // remote plays an illegal move?!
-						std::cout << "= " << "resign" << std::endl << std::endl;
+						io.reply(cmd, "resign");
 						// show the error message and terminate the shell
 						std::cerr << who.role() << " plays an illegal action!" << std::endl;
 						const char* reason[] = {
@@ -145,8 +269,9 @@ int main(int argc, const char* argv[]) {
 					}
 				} else if (args[0] == "genmove") { // generate a move and play
 					action::place move = who.take_action(game.state());
-					if (game.apply_action(move) == true) {
+					if (game.apply_action(move, who.counters()) == true) {
 						reply = move.position();
+						ponder = &who;
 					} else { // I have no legal move to play
 						reply = "resign";
 					}
@@ -161,13 +286,50 @@ int main(int argc, const char* argv[]) {
 				}
 				if (args[0] == "quit") break; // quit GTP shell
 
+			} else if (args[0] == "lz-analyze") { // search and report the root children until the next command arrives
+				// the arguments are the optional color and the interval (centiseconds), e.g., lz-analyze b 50
+				// the position is analyzed with the given color to move, which is the side to move by default
+				board state = stats.is_episode_ongoing() ? stats.back().state() : board();
+				board::piece_type color = state.info().who_take_turns;
+				int interval = 100;
+				bool valid = true;
+				for (size_t i = 1; i < args.size(); i++) {
+					std::string arg = args[i];
+					std::transform(arg.begin(), arg.end(), arg.begin(), ::tolower);
+					if (std::isdigit(arg[0])) interval = std::stoi(arg);
+					else if (arg == "b" || arg == "black") color = board::black;
+					else if (arg == "w" || arg == "white") color = board::white;
+					else valid = false;
+				}
+				if (!valid) {
+					io.reply(cmd, "syntax error", false);
+					continue;
+				}
+				if (color != state.info().who_take_turns) state.info({ color });
+				MCTSplayer& who = color == board::black ? black : white;
+				io.write("=" + cmd.id + "\n");
+				analyzing = true;
+				who.analyze(state, interval * 10, [&]() { return !io.pending(); },
+				            [&](const std::vector<MCTSplayer::analysis>& moves) {
+					std::ostringstream info;
+					for (size_t k = 0; k < moves.size(); k++) {
+						info << (k ? " " : "") << "info move " << std::string(board::point(moves[k].move));
+						info << " visits " << moves[k].visits << " winrate " << int(moves[k].winrate * 10000);
+						info << " order " << k << " pv";
+						for (int mv : moves[k].pv) info << " " << std::string(board::point(mv));
+					}
+					io.write(info.str() + "\n");
+				});
+				analyzing = false;
+				io.write("\n");
+				continue;
 			} else if (args[0] == "showboard") { // print the board
 				std::stringstream buf;
 				buf << (stats.is_episode_ongoing() ? stats.back().state() : board());
 				reply = "\n" + buf.str();
 				reply.pop_back(); // remove a new line
 
-			} else if (args[0] == "boardsize") { // set the board size
+			} else if (args[0] == "boardsize" && args.size() > 1) { // set the board size
 				size_t size = std::stoul(args[1]);
 				if (size != board::size_x || size != board::size_y) {
 					std::cerr << "board size mismatch: " << args[1] << std::endl;
@@ -182,20 +344,24 @@ int main(int argc, const char* argv[]) {
 				reply = "2";
 			} else if (args[0] == "list_commands") { // print supported commands
 				reply = "play\n" "genmove\n" "clear_board\n" "showboard\n" "boardsize\n"
-				        "name\n" "version\n" "protocol_version\n" "list_commands\n" "quit\n";
+				        "name\n" "version\n" "protocol_version\n" "list_commands\n" "lz-analyze\n" "quit\n";
 			} else {
 				reply = "unknown command";
 			}
 
-			std::cout << "= " << reply << std::endl << std::endl;
+			io.reply(cmd, reply);
+			if (ponder) ponder->ponder(stats.back().state());
 		}
 	}
 
-	if (save_path.size()) {
-		std::ofstream out(save_path, std::ios::out | std::ios::trunc);
-		out << stats;
-		out.close();
+	if (save_path.size() && limit) {
+		stats.record(save_path, false, save_flush, save_async, save_counters);
+		stats.save();
 	}
 
+	if (book_path.size()) {
+		size_t entries = book.save(book_path, book_min);
+		std::cerr << "book: " << entries << " of " << book.size() << " positions saved to " << book_path << std::endl;
+	}
 	return 0;
 }
@@ -0,0 +1,261 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * playout.h: Define the random playout engine used by the simulations of the search
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <array>
+#include "board.h"
+#include "bitboard.h"
+
+/**
+ * PCG32 (XSH-RR) random number generator, small and fast enough for the playouts
+ * it also meets the requirements of a uniform random bit generator, e.g., for std::shuffle
+ */
+class pcg32 {
+public:
+	typedef uint32_t result_type;
+
+	pcg32(uint64_t seed = 0) { this->seed(seed); }
+
+	void seed(uint64_t seed) {
+		state = 0;
+		operator()();
+		state += seed;
+		operator()();
+	}
+
+	result_type operator()() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + increment;
+		uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = uint32_t(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+	}
+
+	/**
+	 * a random number in [0, n), by the multiply-shift reduction instead of the modulo
+	 */
+	uint32_t bounded(uint32_t n) { return uint32_t((uint64_t(operator()()) * n) >> 32); }
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+private:
+	static constexpr uint64_t increment = 1442695040888963407ULL;
+	uint64_t state;
+};
+
+/**
+ * uniformly random playouts on the incrementally updated legal moves of the board
+ */
+class playout {
+public:
+	playout(uint64_t seed = 0) : rng(seed) {}
+
+	/**
+	 * play uniformly random legal moves on the state until the side to move has none
+	 * return the winner, i.e., the side who placed the last stone
+	 */
+	board::piece_type run(board& state) {
+		for (bitboard moves; (moves = state.legal_moves(state.info().who_take_turns)); )
+			state.play(moves.select(rng.bounded(moves.count())));
+		return static_cast<board::piece_type>(3u - state.info().who_take_turns);
+	}
+
+	pcg32& engine() { return rng; }
+
+private:
+	pcg32 rng;
+};
+
+/**
+ * random playouts of several independent games at once, one game per SIMD lane
+ * the masks of all lanes are kept in vectors of 64-bit words, so that the flood fills of all the games
+ * run in the same instructions, and the games in the lanes are played in lockstep
+ *
+ * the kernel is compiled for AVX-512 and AVX2, and the best one supported by the host is selected at runtime,
+ * hosts without either of them (and single playouts) fall back to the scalar playouts one after another
+ */
+class batch_playout {
+public:
+	static constexpr unsigned lanes = 8;
+
+	/**
+	 * the stones of black and white at the end of a playout
+	 * since no stone is ever removed in NoGo, these are the stones of the state plus all the moves of the playout
+	 */
+	typedef std::array<bitboard, 2> stones;
+
+	batch_playout(uint64_t seed = 0) : single(seed) {}
+
+	/**
+	 * run n (1 ~ lanes) random playouts from the state at once
+	 * return the results as a mask, where bit k is set if the k-th playout is won by black
+	 * the final stones of the k-th playout are stored to played[k] if given
+	 */
+	unsigned run(const board& state, unsigned n = lanes, stones* played = nullptr) {
+		return n > 1 ? (this->*kernel().run)(state, n, played) : run_scalar(state, n, played);
+	}
+
+	/**
+	 * run a single random playout on the state itself as run(state, 1, played), i.e., without copying the state,
+	 * for the callers whose state is a scratch copy anyway, e.g., the leaves of a search
+	 */
+	unsigned run_in_place(board& state, stones* played = nullptr) {
+		unsigned black_wins = single.run(state) == board::black ? 1 : 0;
+		if (played) played[0] = {{ state.mask(board::black), state.mask(board::white) }};
+		return black_wins;
+	}
+
+	/**
+	 * the name of the instruction set selected for the kernel
+	 */
+	static const char* isa() { return kernel().name; }
+
+	pcg32& engine() { return single.engine(); }
+
+private:
+	/**
+	 * one 128-bit mask per lane, as a vector of the low words and a vector of the high words
+	 */
+	struct masks {
+		typedef uint64_t word __attribute__((vector_size(lanes * sizeof(uint64_t))));
+		word lo, hi;
+
+		masks() : lo(), hi() {}
+		masks(const word& lo, const word& hi) : lo(lo), hi(hi) {}
+		masks(const bitboard& b) : lo(word() + b.lo()), hi(word() + b.hi()) {}
+
+		masks operator ~() const { return { ~lo, ~hi }; }
+		masks operator &(const masks& m) const { return { lo & m.lo, hi & m.hi }; }
+		masks operator |(const masks& m) const { return { lo | m.lo, hi | m.hi }; }
+		masks operator &(const bitboard& b) const { return { lo & b.lo(), hi & b.hi() }; }
+		template <unsigned n> masks shl() const { return { lo << n, (hi << n) | (lo >> (64 - n)) }; }
+		template <unsigned n> masks shr() const { return { (lo >> n) | (hi << (64 - n)), hi >> n }; }
+
+		/**
+		 * the lowest set bit of each lane
+		 */
+		masks lowest() const { return { lo & -lo, hi & -hi & word(lo == 0) }; }
+
+		/**
+		 * all ones in the lanes which are not empty, all zeros in the others
+		 */
+		masks fill() const { word f = word((lo | hi) != 0); return { f, f }; }
+
+		bool any() const {
+			word w = lo | hi;
+			uint64_t any = 0;
+			for (unsigned k = 0; k < lanes; k++) any |= w[k];
+			return any != 0;
+		}
+		bool operator ==(const masks& m) const { return !(*this ^ m).any(); }
+		masks operator ^(const masks& m) const { return { lo ^ m.lo, hi ^ m.hi }; }
+
+		bitboard operator [](unsigned k) const { return bitboard(hi[k], lo[k]); }
+		void set(unsigned k, const bitboard& b) { lo[k] = b.lo(), hi[k] = b.hi(); }
+
+		/**
+		 * the cells adjacent to each lane, as board::neighbor()
+		 */
+		masks neighbor() const {
+			return (((*this & ~board::row(board::size_y - 1)).shl<1>()) | ((*this & ~board::row(0)).shr<1>()) |
+			        shl<board::size_y>() | shr<board::size_y>()) & board::cells();
+		}
+
+		/**
+		 * the block in stones containing the seed of each lane, as board::block()
+		 */
+		masks block(const masks& stones) const {
+			masks blk = *this & stones;
+			for (masks grow = (blk | blk.neighbor()) & stones; !(grow == blk); grow = (blk | blk.neighbor()) & stones) blk = grow;
+			return blk;
+		}
+	};
+
+	/**
+	 * the kernel of the playouts, which follows board::place() in all the lanes at once
+	 * the lanes are always at the same ply, so the side to move is shared by all of them
+	 */
+	unsigned playouts(const board& state, unsigned n, stones* played) {
+		masks stone[2] = { state.mask(board::black), state.mask(board::white) }, space(state.mask(board::empty));
+		masks atari[2] = { state.in_atari(board::black), state.in_atari(board::white) };
+		auto mark_atari = [&](unsigned owner, const masks& blk) {
+			masks lib = blk.neighbor() & space;
+			masks more = (lib & ~lib.lowest()).fill();
+			atari[owner] = (atari[owner] & ~blk) | (blk & ~more);
+		};
+		unsigned active = n < lanes ? (1u << n) - 1 : (1u << lanes) - 1, black_wins = 0;
+		for (unsigned turn = state.info().who_take_turns - 1; active; turn ^= 1) {
+			// draw a legal move in each lane, a lane without legal moves is lost by the side to move
+			masks legal = space & ~atari[turn ^ 1].neighbor() & (space.neighbor() | (stone[turn] & ~atari[turn]).neighbor());
+			masks here;
+			for (unsigned k = 0; k < lanes; k++) {
+				if (!(active & (1u << k))) continue;
+				bitboard moves = legal[k];
+				if (moves) {
+					here.set(k, bitboard::bit(moves.select(engine().bounded(moves.count()))));
+				} else {
+					active &= ~(1u << k);
+					if (turn) black_wins |= 1u << k;
+				}
+			}
+			if (!active) break;
+			// place the stones, and refresh the new blocks and the adjacent blocks of the opponent
+			stone[turn] = stone[turn] | here;
+			space = space & ~here;
+			mark_atari(turn, here.block(stone[turn]));
+			for (masks near = here.neighbor() & stone[turn ^ 1], blk; near.any(); near = near & ~blk) {
+				blk = near.lowest().block(stone[turn ^ 1]);
+				mark_atari(turn ^ 1, blk);
+			}
+		}
+		for (unsigned k = 0; played && k < n; k++) played[k] = {{ stone[0][k], stone[1][k] }};
+		return black_wins;
+	}
+
+	unsigned run_scalar(const board& state, unsigned n, stones* played) {
+		unsigned black_wins = 0;
+		for (unsigned k = 0; k < n; k++) {
+			board after(state);
+			if (single.run(after) == board::black) black_wins |= 1u << k;
+			if (played) played[k] = {{ after.mask(board::black), after.mask(board::white) }};
+		}
+		return black_wins;
+	}
+#if defined(__x86_64__) || defined(__i386__)
+	// the kernel is flattened into each entry, so that all of it is compiled for the instruction set of the entry
+	__attribute__((flatten, target("avx2"))) unsigned run_avx2(const board& state, unsigned n, stones* played) {
+		return playouts(state, n, played);
+	}
+	__attribute__((flatten, target("avx512f,avx512bw,avx512vl"))) unsigned run_avx512(const board& state, unsigned n, stones* played) {
+		return playouts(state, n, played);
+	}
+#endif
+
+	struct kernel_type {
+		unsigned (batch_playout::*run)(const board&, unsigned, stones*);
+		const char* name;
+	};
+	static const kernel_type& kernel() {
+		static const kernel_type selected = []() -> kernel_type {
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+				return { &batch_playout::run_avx512, "avx512" };
+			if (__builtin_cpu_supports("avx2"))
+				return { &batch_playout::run_avx2, "avx2" };
+#endif
+			return { &batch_playout::run_scalar, "scalar" };
+		}();
+		return selected;
+	}
+
+	playout single;
+};
@@ -0,0 +1,118 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * recorder.h: Append-only writer for the records of the episodes
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <memory>
+#include "episode.h"
+#include "archive.h"
+
+/**
+ * write each finished episode as a line of SGF as soon as it is recorded,
+ * or as a record of the binary archive if the path ends with ".bin", see archive
+ *
+ * the file is flushed every 'flush' records (1 by default, i.e., nothing is lost by a crash),
+ * or only when the recorder is closed if flush is 0
+ * with async, the lines are written and flushed by a background thread instead of the caller
+ * with counters, the counters of the searches are written in the comments of the moves of the SGF
+ */
+class recorder {
+public:
+	recorder(const std::string& path, bool append = false, size_t flush = 1, bool async = false, bool counters = false)
+		: flush(flush), unflushed(0), counters(counters), closing(false) {
+		if (is_binary(path)) {
+			binary.reset(new archive::writer(path, append));
+		} else {
+			out.open(path, std::ios::out | (append ? std::ios::app : std::ios::trunc));
+			if (!out) throw std::runtime_error("cannot open " + path);
+		}
+		if (async) writer = std::thread(&recorder::drain, this);
+	}
+	~recorder() {
+		if (writer.joinable()) {
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				closing = true;
+			}
+			ready.notify_one();
+			writer.join();
+		}
+		if (binary) binary->close();
+		out.flush();
+	}
+
+	recorder(const recorder&) = delete;
+	recorder& operator =(const recorder&) = delete;
+
+	void write(const episode& ep) {
+		std::string rec = binary ? archive::encode(ep) : text(ep);
+		if (writer.joinable()) {
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				queue.push_back(std::move(rec));
+			}
+			ready.notify_one();
+		} else {
+			append(rec);
+		}
+	}
+
+	static bool is_binary(const std::string& path) {
+		return path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+	}
+
+private:
+	std::string text(const episode& ep) const {
+		std::ostringstream line;
+		ep.write(line, counters) << std::endl;
+		return line.str();
+	}
+
+	void append(const std::string& rec) {
+		if (binary) binary->append(rec);
+		else out << rec;
+		if (flush && ++unflushed >= flush) {
+			if (binary) binary->flush();
+			else out.flush();
+			unflushed = 0;
+		}
+	}
+
+	void drain() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			ready.wait(lock, [this]() { return queue.size() || closing; });
+			if (queue.empty()) break;
+			std::deque<std::string> lines;
+			lines.swap(queue);
+			lock.unlock();
+			for (const std::string& line : lines) append(line);
+			lock.lock();
+		}
+	}
+
+private:
+	std::ofstream out;
+	std::unique_ptr<archive::writer> binary;
+	size_t flush;
+	size_t unflushed;
+	bool counters;
+	bool closing;
+	std::deque<std::string> queue;
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::thread writer;
+};
@@ -0,0 +1,675 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * remote.h: Coordinator and workers of the games and the searches on other hosts
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <sstream>
+#include <set>
+#include <vector>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "episode.h"
+#include "statistics.h"
+#include "archive.h"
+
+/**
+ * the networked mode, where a coordinator hands out whole games or root parallel searches to the workers on other hosts
+ *
+ * each message is a uint32 size of the rest, a uint8 type, and the payload of the type, i.e.,
+ *   hello:  uint32 version, uint32 cells of the board, varint size and key (from a worker right after it connects)
+ *   game:   uint32 job, varint size and args of black, varint size and args of white
+ *   record: uint32 job, the record of the finished game (see archive::encode), or nothing if the game failed
+ *   search: uint32 job, varint size and args of the player, uint8 per cell (board::cell), uint8 side to move,
+ *           uint32 iterations, uint32 budget (ms, or 0 to search for the iterations)
+ *   visits: uint32 job, uint32 iterations, varint wins and varint visits (of the side to move) of each cell
+ * all the integers are little-endian, the varints are unsigned LEB128
+ *
+ * a worker runs a single job at a time, so that a host runs a worker per core
+ * the coordinator listens on the loopback unless a host is given, and accepts only the workers with its key,
+ * where a connection without a hello within the handshake time is closed, so that it does not hold a slot,
+ * while a worker builds its players only from the search options in allowed(), so that no path is opened for a peer
+ * the game of a lost worker (closed connection) or a slow worker (no record before the timeout) is given up and
+ * reserved again by another worker, and a late record is dropped; a search waits for its helpers until its budget
+ * (or the time of its own iterations) and a grace period pass, the late visits are dropped, and a helper still
+ * searching after the timeout is disconnected
+ */
+class remote {
+public:
+	class coordinator;
+	class worker;
+
+	enum message : uint8_t { hello = 1, game = 2, record = 3, search = 4, visits = 5 };
+
+	/**
+	 * whether the arguments of a player contain only the search options, and store the first other key if any
+	 * the options opening files (e.g., book, model) or talking to the terminal (e.g., ponder) are not served
+	 */
+	static bool allowed(const std::string& args, std::string* rejected = nullptr) {
+		static const std::set<std::string> options = {
+			"name", "role", "seed", "T", "timeout", "budget_ms", "game_time", "threads", "parallel", "nodes",
+			"reuse", "batch", "sym", "rave", "rave_k", "widen", "search", "depth",
+			"solve", "solve_nodes", "solve_leaf", "solve_bits", "tt", "tt_bits",
+		};
+		std::stringstream ss(args);
+		for (std::string pair; ss >> pair; ) {
+			std::string key = pair.substr(0, pair.find('='));
+			if (options.count(key)) continue;
+			if (rejected) *rejected = key;
+			return false;
+		}
+		return true;
+	}
+
+protected:
+	static constexpr uint32_t version = 2;
+	static constexpr size_t max_message = 1 << 24;
+
+	/**
+	 * a socket listening on or connected to the address, i.e., "host:port", ":port", or "port"
+	 * return -1 if failed
+	 */
+	static int open_socket(const std::string& address, bool listening) {
+		size_t colon = address.rfind(':');
+		std::string host = colon != std::string::npos ? address.substr(0, colon) : "";
+		std::string port = colon != std::string::npos ? address.substr(colon + 1) : address;
+		if (host.empty()) host = "127.0.0.1"; // only the local workers by default
+		addrinfo hints = {}, *result = nullptr;
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = listening ? AI_PASSIVE : 0;
+		if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) return -1;
+		int fd = -1;
+		for (addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next) {
+			fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (fd < 0) continue;
+			int on = 1;
+			bool ok = listening ? ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0
+			                      && ::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 64) == 0
+			                    : ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+			if (!ok) ::close(fd), fd = -1;
+		}
+		::freeaddrinfo(result);
+		if (fd >= 0 && !listening) no_delay(fd);
+		return fd;
+	}
+	static void no_delay(int fd) {
+		int on = 1;
+		::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+
+	/**
+	 * the message of the type and the payload, with its leading size
+	 */
+	static std::string frame(message type, const std::string& payload) {
+		std::string buf;
+		put_fixed(buf, uint32_t(payload.size() + 1));
+		buf += char(type);
+		return buf + payload;
+	}
+
+	/**
+	 * take a complete message from the front of the buffer, return false if it is incomplete
+	 * a message larger than max_message is taken as its type 0, i.e., a broken stream
+	 */
+	static bool unframe(std::string& buf, uint8_t& type, std::string& payload) {
+		if (buf.size() < 4) return false;
+		uint32_t size = get_fixed<uint32_t>(buf.data());
+		if (size == 0 || size > max_message) {
+			type = 0;
+			return true;
+		}
+		if (buf.size() < 4 + size) return false;
+		type = uint8_t(buf[4]);
+		payload.assign(buf, 5, size - 1);
+		buf.erase(0, 4 + size);
+		return true;
+	}
+
+	/**
+	 * the cells and the side to move of a board, and back
+	 */
+	static void put_board(std::string& buf, const board& state) {
+		for (int i = 0; i < board::size_x * board::size_y; i++) buf += char(state(i));
+		buf += char(state.info().who_take_turns);
+	}
+	static bool get_board(const char*& it, const char* end, board& state) {
+		if (end - it < board::size_x * board::size_y + 1) return false;
+		board::grid g;
+		for (int i = 0; i < board::size_x * board::size_y; i++) g[i / board::size_y][i % board::size_y] = board::cell(uint8_t(*(it++)));
+		board::data d;
+		d.who_take_turns = board::piece_type(uint8_t(*(it++)));
+		state = board(g, d);
+		return true;
+	}
+
+	static void put_string(std::string& buf, const std::string& s) {
+		put_varint(buf, s.size());
+		buf += s;
+	}
+	static bool get_string(const char*& it, const char* end, std::string& s) {
+		uint64_t len;
+		if (!get_varint(it, end, len) || uint64_t(end - it) < len) return false;
+		s.assign(it, len);
+		it += len;
+		return true;
+	}
+
+	template<typename type> static void put_fixed(std::string& buf, type v) {
+		for (size_t i = 0; i < sizeof(type); i++) buf += char((v >> (8 * i)) & 0xff);
+	}
+	template<typename type> static type get_fixed(const char* it) {
+		type v = 0;
+		for (size_t i = 0; i < sizeof(type); i++) v |= type(uint8_t(it[i])) << (8 * i);
+		return v;
+	}
+	template<typename type> static bool get_fixed(const char*& it, const char* end, type& v) {
+		if (size_t(end - it) < sizeof(type)) return false;
+		v = get_fixed<type>(it);
+		it += sizeof(type);
+		return true;
+	}
+	static void put_varint(std::string& buf, uint64_t v) {
+		for (; v >= 0x80; v >>= 7) buf += char(0x80 | (v & 0x7f));
+		buf += char(v);
+	}
+	static bool get_varint(const char*& it, const char* end, uint64_t& v) {
+		v = 0;
+		for (unsigned shift = 0; it != end && shift < 64; shift += 7) {
+			uint8_t byte = uint8_t(*(it++));
+			v |= uint64_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+};
+
+/**
+ * the coordinator, which accepts the workers and talks to all of them on its own thread
+ * the games are handed out once farm() is called, and the searches are helped as the search_helpers of the players
+ */
+class remote::coordinator : public search_helpers, protected remote {
+public:
+	/**
+	 * listen on the address for the workers with the key, where a game is given up after timeout (ms) without its
+	 * record, and a search helper is disconnected after timeout (ms) past the budget of the search
+	 */
+	coordinator(const std::string& address, int timeout = 600000, const std::string& key = "") : timeout(timeout), key(key) {
+		listener = open_socket(address, true);
+		if (listener < 0) throw std::runtime_error("cannot listen on " + address);
+		if (::pipe(wakeup) != 0) {
+			::close(listener);
+			throw std::runtime_error("cannot create the pipe of " + address);
+		}
+		::fcntl(listener, F_SETFL, O_NONBLOCK);
+		io = std::thread(&coordinator::loop, this);
+	}
+	~coordinator() {
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			closing = true;
+		}
+		notify();
+		io.join();
+		for (peer& p : peers) ::close(p.fd);
+		::close(listener);
+		::close(wakeup[0]), ::close(wakeup[1]);
+	}
+
+	coordinator(const coordinator&) = delete;
+	coordinator& operator =(const coordinator&) = delete;
+
+	/**
+	 * hand out the episodes reserved from the statistics to the idle workers, until all of them are reserved,
+	 * where players(k) gives the arguments of black and white of the k-th game handed out
+	 * the records are merged into the statistics as the episodes of parallel workers, see statistics::merge_episode()
+	 */
+	void farm(statistics& stats, std::function<std::pair<std::string, std::string>(size_t)> players) {
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			this->stats = &stats;
+			this->players = players;
+		}
+		notify();
+	}
+
+	/**
+	 * the number of the workers connected
+	 */
+	size_t workers() {
+		std::lock_guard<std::mutex> guard(mutex);
+		return std::count_if(peers.begin(), peers.end(), [](const peer& p) { return p.ready; });
+	}
+
+	/**
+	 * start the search of the player on all the idle workers, each with its own seed
+	 * the player searches alone if it has any option not allowed(), which the workers would refuse
+	 */
+	virtual void start(const board& state, const std::string& args, int iterations, int budget_ms) {
+		if (!allowed(args)) return;
+		unsigned seed = std::default_random_engine::default_seed;
+		try { seed = std::stoul(agent(args).property("seed")); } catch (std::out_of_range&) {}
+		std::lock_guard<std::mutex> guard(mutex);
+		searching = next_job++;
+		search_start = std::chrono::steady_clock::now();
+		search_budget = budget_ms;
+		replies = expected = 0;
+		helped = 0;
+		win = {};
+		games = {};
+		for (peer& p : peers) {
+			if (!p.ready || p.job) continue;
+			std::string payload;
+			put_fixed(payload, searching);
+			put_string(payload, args + " seed=" + std::to_string(seed + 1000003 * (++expected)));
+			put_board(payload, state);
+			put_fixed(payload, uint32_t(iterations));
+			put_fixed(payload, uint32_t(budget_ms));
+			p.out += frame(search, payload);
+			p.job = searching;
+			p.kind = search;
+			p.deadline = search_start + std::chrono::milliseconds(budget_ms + timeout);
+		}
+		notify();
+	}
+
+	/**
+	 * wait for the visits of the workers of the search and add them, where the workers are waited for the budget of
+	 * the search, or as long as the player took for the same iterations, plus a grace period
+	 */
+	virtual size_t collect(std::array<int, board::size_x * board::size_y>& win, std::array<int, board::size_x * board::size_y>& games) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!searching) return 0;
+		auto now = std::chrono::steady_clock::now();
+		auto deadline = search_budget ? search_start + std::chrono::milliseconds(search_budget + grace)
+		                              : now + (now - search_start) + std::chrono::milliseconds(grace);
+		done.wait_until(lock, deadline, [this]() { return replies >= expected; });
+		for (int i = 0; i < board::size_x * board::size_y; i++) {
+			win[i] += this->win[i];
+			games[i] += this->games[i];
+		}
+		searching = 0;
+		return helped;
+	}
+
+private:
+	struct peer {
+		int fd;
+		std::string name;
+		std::string in, out;
+		bool ready = false;   // after the hello
+		uint32_t job = 0;     // the running job, or 0 if idle
+		message kind = hello; // the type of the running job
+		bool released = false; // whether the game of the job is given up
+		std::chrono::steady_clock::time_point deadline; // of the job, or of the hello before ready
+		bool lost = false;
+	};
+
+	void notify() {
+		if (::write(wakeup[1], "", 1) < 0) {}
+	}
+
+	void loop() {
+		std::vector<pollfd> fds;
+		while (true) {
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				if (closing) return;
+				assign();
+				expire();
+				fds.assign(1, pollfd{ wakeup[0], POLLIN, 0 });
+				fds.push_back(pollfd{ listener, POLLIN, 0 });
+				for (const peer& p : peers)
+					fds.push_back(pollfd{ p.fd, short(POLLIN | (p.out.size() ? POLLOUT : 0)), 0 });
+			}
+			::poll(fds.data(), fds.size(), 1000); // at least every second for the deadlines
+			std::lock_guard<std::mutex> guard(mutex);
+			if (fds[0].revents) {
+				char buf[64];
+				if (::read(wakeup[0], buf, sizeof(buf)) < 0) {}
+			}
+			for (size_t k = 0; k + 2 < fds.size(); k++) {
+				peer& p = peers[k];
+				if (fds[k + 2].revents & (POLLIN | POLLHUP | POLLERR)) receive(p);
+				if (!p.lost && (fds[k + 2].revents & POLLOUT)) {
+					ssize_t n = ::send(p.fd, p.out.data(), p.out.size(), MSG_NOSIGNAL);
+					if (n > 0) p.out.erase(0, n);
+					else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) p.lost = true;
+				}
+			}
+			for (size_t k = 0; k < peers.size(); ) {
+				if (peers[k].lost) drop(k);
+				else k++;
+			}
+			if (fds[1].revents & POLLIN) accept();
+		}
+	}
+
+	void accept() {
+		sockaddr_storage addr;
+		socklen_t len = sizeof(addr);
+		int fd = ::accept(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+		if (fd < 0) return;
+		::fcntl(fd, F_SETFL, O_NONBLOCK);
+		no_delay(fd);
+		char host[NI_MAXHOST] = "?", port[NI_MAXSERV] = "?";
+		::getnameinfo(reinterpret_cast<sockaddr*>(&addr), len, host, sizeof(host), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV);
+		peers.emplace_back();
+		peers.back().fd = fd;
+		peers.back().name = std::string(host) + ":" + port;
+		peers.back().deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(handshake);
+	}
+
+	/**
+	 * close the connection of a lost worker, and give up its job
+	 */
+	void drop(size_t k) {
+		peer& p = peers[k];
+		if (p.ready) std::cerr << "worker " << p.name << " lost" << std::endl;
+		if (p.job && p.kind == game && !p.released) stats->release_episode();
+		if (p.job && p.kind == search && p.job == searching) {
+			expected--;
+			done.notify_all();
+		}
+		::close(p.fd);
+		peers.erase(peers.begin() + k);
+	}
+
+	/**
+	 * hand out the reserved games to the idle workers
+	 */
+	void assign() {
+		if (!stats) return;
+		for (peer& p : peers) {
+			if (!p.ready || p.job) continue;
+			if (!stats->reserve_episode()) return;
+			std::pair<std::string, std::string> args = players(handed++);
+			std::string payload;
+			put_fixed(payload, next_job);
+			put_string(payload, args.first);
+			put_string(payload, args.second);
+			p.out += frame(game, payload);
+			p.job = next_job++;
+			p.kind = game;
+			p.released = false;
+			p.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+		}
+	}
+
+	/**
+	 * give up the games of the slow workers, whose records will be dropped, and disconnect the hanging helpers
+	 * and the connections that never sent their hello
+	 */
+	void expire() {
+		auto now = std::chrono::steady_clock::now();
+		for (peer& p : peers) {
+			if (!p.ready && !p.lost && now >= p.deadline) {
+				std::cerr << "worker " << p.name << " sent no hello" << std::endl;
+				p.lost = true;
+			}
+			if (p.job && p.kind == game && !p.released && now >= p.deadline) {
+				std::cerr << "worker " << p.name << " timed out" << std::endl;
+				stats->release_episode();
+				p.released = true;
+			}
+			if (p.job && p.kind == search && !p.lost && now >= p.deadline) {
+				std::cerr << "worker " << p.name << " timed out" << std::endl;
+				p.lost = true; // dropped by the loop, see drop()
+			}
+		}
+	}
+
+	void receive(peer& p) {
+		char chunk[65536];
+		ssize_t n = ::recv(p.fd, chunk, sizeof(chunk), 0);
+		if (n <= 0) {
+			if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) p.lost = true;
+			return;
+		}
+		p.in.append(chunk, n);
+		uint8_t type;
+		std::string payload;
+		while (!p.lost && unframe(p.in, type, payload)) handle(p, type, payload);
+	}
+
+	void handle(peer& p, uint8_t type, const std::string& payload) {
+		const char* it = payload.data();
+		const char* end = it + payload.size();
+		uint32_t job = 0;
+		if (type == hello) {
+			uint32_t v = 0, cells = 0;
+			std::string k;
+			p.ready = get_fixed(it, end, v) && get_fixed(it, end, cells) && get_string(it, end, k)
+			          && v == version && cells == board::size_x * board::size_y && k == key;
+			p.lost = !p.ready;
+			std::cerr << "worker " << p.name << (p.ready ? " joined" : " rejected") << std::endl;
+
+		} else if (type == record && get_fixed(it, end, job) && job == p.job && p.kind == game) {
+			episode ep;
+			bool valid = archive::decode(it, end - it, ep);
+			if (!p.released && valid) stats->merge_episode(std::move(ep));
+			if (!p.released && !valid) stats->release_episode();
+			p.job = 0;
+			p.lost = !valid; // a worker failing its games is not given any more
+
+		} else if (type == visits && get_fixed(it, end, job) && job == p.job && p.kind == search) {
+			uint32_t iterations = 0;
+			std::array<int, board::size_x * board::size_y> w = {}, g = {};
+			bool valid = get_fixed(it, end, iterations);
+			for (int i = 0; valid && i < board::size_x * board::size_y; i++) {
+				uint64_t a, b;
+				valid = get_varint(it, end, a) && get_varint(it, end, b);
+				w[i] = int(a);
+				g[i] = int(b);
+			}
+			if (job == searching) {
+				if (valid) {
+					for (int i = 0; i < board::size_x * board::size_y; i++) win[i] += w[i], games[i] += g[i];
+					helped += iterations;
+				}
+				replies++;
+				done.notify_all();
+			}
+			p.job = 0;
+
+		} else if (type != record && type != visits) {
+			p.lost = true; // an unknown message, or a broken stream
+		}
+	}
+
+private:
+	static constexpr int grace = 200; // the ms to wait for the helpers after the budget of a search
+	static constexpr int handshake = 10000; // the ms for a worker to send its hello after it connects
+	int timeout;
+	std::string key;
+	int listener;
+	int wakeup[2];
+	std::thread io;
+	std::mutex mutex;
+	std::condition_variable done;
+	bool closing = false;
+	std::vector<peer> peers;
+	uint32_t next_job = 1;
+	statistics* stats = nullptr;
+	std::function<std::pair<std::string, std::string>(size_t)> players;
+	size_t handed = 0;
+	uint32_t searching = 0; // the job of the running search, or 0 if none
+	int replies = 0, expected = 0;
+	size_t helped = 0;
+	std::array<int, board::size_x * board::size_y> win = {}, games = {};
+	std::chrono::steady_clock::time_point search_start;
+	int search_budget = 0;
+};
+
+/**
+ * the worker, which connects to the coordinator, and plays the games or searches the positions it is given
+ */
+class remote::worker : protected remote {
+public:
+	/**
+	 * connect to the address of the coordinator with the key, and keep reconnecting for at most retry (ms) after losing it
+	 */
+	worker(const std::string& address, const std::string& key = "", int retry = 60000) : address(address), key(key), retry(retry) {}
+
+	/**
+	 * serve the jobs until the coordinator is gone for retry ms, or until it sends a player with options not allowed,
+	 * return the number of the jobs served
+	 */
+	size_t serve() {
+		size_t served = 0;
+		auto gone = std::chrono::steady_clock::now();
+		while (std::chrono::steady_clock::now() - gone < std::chrono::milliseconds(retry)) {
+			int fd = open_socket(address, false);
+			if (fd < 0) {
+				std::this_thread::sleep_for(std::chrono::seconds(1));
+				continue;
+			}
+			std::string payload;
+			put_fixed(payload, version);
+			put_fixed(payload, uint32_t(board::size_x * board::size_y));
+			put_string(payload, key);
+			std::string buf;
+			uint8_t type;
+			try {
+				for (bool alive = send_all(fd, frame(hello, payload)); alive && next(fd, buf, type, payload); ) {
+					if (type == game) alive = send_all(fd, frame(record, play(payload)));
+					else if (type == search) alive = send_all(fd, frame(visits, think(payload)));
+					else alive = false;
+					served++;
+				}
+			} catch (std::invalid_argument& e) { // a coordinator asking for other options is never served again
+				std::cerr << e.what() << std::endl;
+				::close(fd);
+				return served;
+			}
+			::close(fd);
+			gone = std::chrono::steady_clock::now();
+		}
+		return served;
+	}
+
+private:
+	/**
+	 * play the game of the job, and return the payload of its record
+	 */
+	std::string play(const std::string& job) {
+		const char* it = job.data();
+		const char* end = it + job.size();
+		uint32_t id = 0;
+		std::string black_args, white_args, reply;
+		if (!get_fixed(it, end, id)) return reply;
+		put_fixed(reply, id);
+		if (!get_string(it, end, black_args) || !get_string(it, end, white_args)) return reply;
+		check(black_args);
+		check(white_args);
+		try {
+			MCTSplayer black(black_args), white(white_args);
+			black.open_episode("~:" + white.name());
+			white.open_episode(black.name() + ":~");
+			episode game;
+			game.open_episode(black.name() + ":" + white.name());
+			while (true) {
+				agent& who = game.take_turns(black, white);
+				action move = who.take_action(game.state());
+				if (game.apply_action(move, who.counters()) != true) break;
+				if (who.check_for_win(game.state())) break;
+			}
+			agent& win = game.last_turns(black, white);
+			game.close_episode(win.name());
+			black.close_episode(win.name());
+			white.close_episode(win.name());
+			reply += archive::encode(game);
+		} catch (std::exception& e) {
+			std::cerr << "game failed: " << e.what() << std::endl;
+		}
+		return reply;
+	}
+
+	/**
+	 * search the position of the job, and return the payload of its visits
+	 */
+	std::string think(const std::string& job) {
+		const char* it = job.data();
+		const char* end = it + job.size();
+		uint32_t id = 0, iterations = 0, budget = 0;
+		std::string args, reply;
+		board state;
+		if (!get_fixed(it, end, id)) return reply;
+		put_fixed(reply, id);
+		if (!get_string(it, end, args) || !get_board(it, end, state)
+		    || !get_fixed(it, end, iterations) || !get_fixed(it, end, budget)) return reply;
+		check(args);
+		try {
+			MCTSplayer player(args);
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget);
+			player.search(state, budget ? INT_MAX : int(std::min(iterations, uint32_t(INT_MAX))), budget ? &deadline : nullptr);
+			put_fixed(reply, uint32_t(player.iterations()));
+			for (int i = 0; i < board::size_x * board::size_y; i++) {
+				put_varint(reply, player.wins()[i]);
+				put_varint(reply, player.visits()[i]);
+			}
+		} catch (std::exception& e) {
+			std::cerr << "search failed: " << e.what() << std::endl;
+		}
+		return reply;
+	}
+
+	/**
+	 * throw if the arguments of a player contain an option not allowed
+	 */
+	static void check(const std::string& args) {
+		std::string rejected;
+		if (!allowed(args, &rejected)) throw std::invalid_argument("option " + rejected + " is not served: " + args);
+	}
+
+	/**
+	 * wait for the next message, return false if the connection is closed or broken
+	 */
+	static bool next(int fd, std::string& buf, uint8_t& type, std::string& payload) {
+		char chunk[65536];
+		while (!unframe(buf, type, payload)) {
+			ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			buf.append(chunk, n);
+		}
+		return type != 0;
+	}
+
+	static bool send_all(int fd, const std::string& data) {
+		for (size_t done = 0; done < data.size(); ) {
+			ssize_t n = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			done += n;
+		}
+		return true;
+	}
+
+private:
+	std::string address;
+	std::string key;
+	int retry;
+};
@@ -0,0 +1,226 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * selfplay.cpp: Generator of the training data from the self-play games of the players
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <numeric>
+#include <mutex>
+#include <stdexcept>
+#include <zlib.h>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "evaluator.h"
+
+/**
+ * the shards of the training samples, each a gzip file of a header and the samples of several games
+ *
+ *   header: "NOGOSP" '\0' '\0', uint32 version, uint32 cells, uint32 channels, uint32 size of each sample
+ *   sample: the input planes of evaluator::encode(), packed as 1 bit per value (from the lowest bit of each byte),
+ *           uint16 root visits of each cell (saturated at 65535), or 1 at the move played if it was not searched,
+ *           e.g., a move of the opening book or of the endgame solver, int8 outcome for the side to move (+1 win, -1 loss),
+ *           uint8 symmetry (0 ~ 7, see board::transform) applied to the position of the game
+ * all the integers are little-endian, and each position of a game is written in all the 8 symmetries
+ *
+ * each worker writes its own shards, so that the compression runs in parallel without any locking,
+ * and a shard is closed after every 'games' games, so that the finished shards are ready for the training
+ */
+class sample_writer {
+public:
+	enum { cells = evaluator::cells, plane_bytes = (evaluator::plane_size + 7) / 8 };
+	enum { sample_size = plane_bytes + 2 * cells + 2 };
+	typedef std::array<int, cells> visits;
+
+	sample_writer(const std::string& prefix, size_t worker, size_t games = 1000, int level = 1)
+		: prefix(prefix), worker(worker), games(games), level(level), file(nullptr), shard(0), count(0), samples(0) {}
+	~sample_writer() { close(); }
+
+	sample_writer(const sample_writer&) = delete;
+	sample_writer& operator =(const sample_writer&) = delete;
+
+	/**
+	 * write the positions of a finished game with the root visits of their searches, given the winner
+	 */
+	void write(const std::vector<board>& positions, const std::vector<visits>& searches, unsigned winner) {
+		if (!file) open();
+		std::string buf;
+		buf.reserve(positions.size() * 8 * sample_size);
+		for (size_t k = 0; k < positions.size(); k++) {
+			int8_t outcome = positions[k].info().who_take_turns == winner ? 1 : -1;
+			for (int s = 0; s < 8; s++) append(buf, positions[k], searches[k], outcome, s);
+		}
+		if (buf.size() && gzwrite(file, buf.data(), buf.size()) != int(buf.size()))
+			throw std::runtime_error("cannot write " + path());
+		samples += positions.size() * 8;
+		if (++count % games == 0) close();
+	}
+
+	size_t written() const { return samples; }
+
+private:
+	static void append(std::string& buf, const board& position, const visits& searched, int8_t outcome, int s) {
+		board after(position);
+		after.transform(s);
+		evaluator::planes planes;
+		evaluator::encode(after, planes);
+		for (size_t i = 0; i < evaluator::plane_size; i += 8) {
+			uint8_t byte = 0;
+			for (size_t b = 0; b < 8 && i + b < evaluator::plane_size; b++) byte |= (planes[i + b] != 0) << b;
+			buf += char(byte);
+		}
+		std::array<uint16_t, cells> moved = {};
+		for (int i = 0; i < cells; i++) moved[board::symmetric(i, s)] = std::min(searched[i], 65535);
+		for (uint16_t v : moved) buf += char(v & 0xff), buf += char(v >> 8);
+		buf += char(outcome);
+		buf += char(s);
+	}
+
+	std::string path() const {
+		return prefix + "." + std::to_string(worker) + "." + std::to_string(shard) + ".gz";
+	}
+
+	void open() {
+		file = gzopen(path().c_str(), ("wb" + std::to_string(level)).c_str());
+		if (!file) throw std::runtime_error("cannot open " + path());
+		std::string header("NOGOSP\0\0", 8);
+		for (uint32_t v : { 1u, uint32_t(cells), uint32_t(evaluator::channels), uint32_t(sample_size) })
+			for (int b = 0; b < 4; b++) header += char((v >> (8 * b)) & 0xff);
+		gzwrite(file, header.data(), header.size());
+	}
+
+	void close() {
+		if (!file) return;
+		gzclose(file);
+		file = nullptr;
+		shard++;
+	}
+
+private:
+	std::string prefix;
+	size_t worker;
+	size_t games;
+	int level;
+	gzFile file;
+	size_t shard;
+	size_t count;
+	size_t samples;
+};
+
+/**
+ * play a self-play game, and write its positions to the writer
+ * the moves of the first 'sample' plies are drawn in proportion to the root visits instead of the best ones,
+ * so that the games of the same players are diverse
+ */
+void play_game(MCTSplayer& black, MCTSplayer& white, sample_writer& writer, int sample, std::default_random_engine& engine) {
+	black.open_episode("~:" + white.name());
+	white.open_episode(black.name() + ":~");
+	board state;
+	std::vector<board> positions;
+	std::vector<sample_writer::visits> searches;
+	for (int ply = 0; ; ply++) {
+		MCTSplayer& who = ply % 2 ? white : black;
+		if (!state.legal_moves(state.info().who_take_turns)) break;
+		action move = who.take_action(state);
+		sample_writer::visits visits = who.visits();
+		if (ply < sample && std::accumulate(visits.begin(), visits.end(), 0)) {
+			std::discrete_distribution<int> draw(visits.begin(), visits.end());
+			move = action::place(draw(engine), state.info().who_take_turns);
+		} else if (!std::accumulate(visits.begin(), visits.end(), 0)) {
+			// a move taken without the search, whose target is the move itself
+			int i = action::place(move).position().i;
+			if (i >= 0 && i < sample_writer::cells) visits[i] = 1;
+		}
+		positions.push_back(state);
+		searches.push_back(visits);
+		if (move.apply(state) != board::legal) break;
+	}
+	unsigned winner = 3u - state.info().who_take_turns; // the side who placed the last stone
+	writer.write(positions, searches, winner);
+	black.close_episode(winner == board::black ? black.name() : white.name());
+	white.close_episode(winner == board::black ? black.name() : white.name());
+}
+
+int main(int argc, const char* argv[]) {
+	std::cout << "HollowNoGo-SelfPlay: ";
+	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
+	std::cout << std::endl << std::endl;
+
+	size_t total = 1000, block = 0, workers = std::max(std::thread::hardware_concurrency(), 1u), shard = 1000;
+	std::string args, prefix = "selfplay";
+	int sample = 0, level = 1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		auto match_arg = [&](std::string flag) -> bool {
+			auto it = arg.find_first_not_of('-');
+			return arg.find(flag, it) == it;
+		};
+		auto next_opt = [&]() -> std::string {
+			auto it = arg.find('=') + 1;
+			return it ? arg.substr(it) : argv[++i];
+		};
+		if (match_arg("total")) {
+			total = std::stoull(next_opt());
+		} else if (match_arg("block")) {
+			block = std::stoull(next_opt());
+		} else if (match_arg("workers")) {
+			workers = std::max(std::stoull(next_opt()), 1ull);
+		} else if (match_arg("shard")) {
+			shard = std::max(std::stoull(next_opt()), 1ull);
+		} else if (match_arg("sample")) {
+			sample = std::stoi(next_opt());
+		} else if (match_arg("level")) {
+			level = std::stoi(next_opt());
+		} else if (match_arg("args")) {
+			args = next_opt();
+		} else if (match_arg("save")) {
+			prefix = next_opt();
+		}
+	}
+	block = block ? block : total;
+
+	// each worker plays its games with its own players, seeded apart, and writes its own shards
+	std::atomic<size_t> next(0), finished(0), samples(0);
+	std::mutex report;
+	auto start = std::chrono::steady_clock::now();
+	auto worker = [&](size_t k) {
+		MCTSplayer black("name=black role=black " + args + " seed=" + std::to_string(1000003 * k + 1));
+		MCTSplayer white("name=white role=white " + args + " seed=" + std::to_string(1000003 * k + 2));
+		std::default_random_engine engine(k);
+		sample_writer writer(prefix, k, shard, level);
+		while (next++ < total) {
+			size_t before = writer.written();
+			play_game(black, white, writer, sample, engine);
+			samples += writer.written() - before;
+			size_t done = ++finished;
+			if (done % block == 0) {
+				std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+				std::lock_guard<std::mutex> guard(report);
+				std::cout << done << "\t" << "samples = " << samples << ", ";
+				std::cout << "games/s = " << (done / time.count()) << std::endl;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t k = 1; k < std::min(workers, total); k++) threads.emplace_back(worker, k);
+	worker(0);
+	for (std::thread& thread : threads) thread.join();
+
+	std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+	std::cout << std::endl << finished << " games, " << samples << " samples ";
+	std::cout << "(" << sample_writer::sample_size << " bytes each) in " << time.count() << " s" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * solver.h: Define the alpha-beta search and the endgame solver on the bitboards
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include "board.h"
+
+/**
+ * alpha-beta search of the side to move, either to a fixed depth or to the end of the game
+ * a position without any legal move is lost for the side to move, and a position at the depth limit
+ * is valued by its mobility, i.e., the legal moves of the side to move minus those of the opponent
+ *
+ * a lost position is valued -win, which is never reached by the mobility, so that a value of +-win is exact
+ * even if the search is cut off or runs out of its budget of nodes, i.e., the position is solved
+ * the solved positions are kept in a table of their hashes, together with the best moves for the move ordering
+ * the moves are made and taken back on a single board, and a solver is used by a single thread
+ */
+class Solver
+{
+public:
+	enum { win = 1000 };
+
+	Solver(int bits = 16) : entries(size_t(1) << bits), mask((size_t(1) << bits) - 1) {}
+
+	/**
+	 * solve the state for the side to move within the budget of nodes (and the deadline if given),
+	 * and store the best move if any, return 1 if the side to move wins, -1 if it loses, or 0 if the budget ran out
+	 */
+	int solve(board &state, size_t budget, int *best = nullptr, const std::chrono::steady_clock::time_point *deadline = nullptr)
+	{
+		int value = search(state, INT_MAX, budget, best, deadline);
+		return value >= win ? 1 : (value <= -win ? -1 : 0);
+	}
+
+	/**
+	 * the alpha-beta value of the state to the given depth within the budget of nodes (and the deadline if given),
+	 * and store the best move if any; the depth is deepened iteratively, so that each iteration is ordered by
+	 * the best moves of the previous one, and the value of the deepest finished iteration is returned
+	 */
+	int search(board &state, int depth, size_t budget, int *best = nullptr,
+			   const std::chrono::steady_clock::time_point *deadline = nullptr)
+	{
+		searched = 0;
+		reached = 0;
+		limit = budget;
+		aborted = false;
+		timed = deadline != nullptr;
+		checked = 0;
+		if (timed)
+			this->deadline = *deadline;
+		int value = 0, move = -1;
+		for (int d = 1; d <= depth; d++)
+		{
+			int found = -1;
+			int v = negamax(state, d, -win, win, &found);
+			if (aborted && v > -win && v < win)
+			{
+				if (move == -1)
+					move = found; // still a legal move, although not searched to the end of the first iteration
+				break;
+			}
+			value = v;
+			move = found;
+			reached = d;
+			if (aborted || v >= win || v <= -win)
+				break;
+		}
+		if (best)
+			*best = move;
+		return value;
+	}
+
+	/**
+	 * the nodes of the last search, and the depth of its deepest finished iteration
+	 */
+	size_t nodes() const { return searched; }
+	int depth() const { return reached; }
+
+	void clear() { std::fill(entries.begin(), entries.end(), Entry()); }
+
+	/**
+	 * the bytes of the table
+	 */
+	size_t memory() const { return entries.size() * sizeof(Entry); }
+
+private:
+	struct Entry
+	{
+		uint64_t key = 0;
+		int8_t solved = 0; // 1 if the side to move wins, -1 if it loses, or 0 if unknown
+		int8_t move = -1;  // the best move found by the last search of the position
+	};
+
+	int negamax(board &state, int depth, int alpha, int beta, int *best = nullptr)
+	{
+		searched++;
+		board::piece_type turn = state.info().who_take_turns;
+		board::piece_type opp = board::piece_type(3 - turn);
+		bitboard moves = state.legal_moves(turn);
+		if (!moves)
+			return -win;
+		uint64_t key = state.hash() ? state.hash() : 1; // 0 marks an empty entry
+		Entry &entry = entries[key & mask];
+		if (entry.key == key && entry.solved)
+		{
+			if (best)
+				*best = entry.move;
+			return entry.solved * win;
+		}
+		if (depth == 0)
+			return int(moves.count()) - int(state.legal_moves(opp).count());
+		if (searched >= limit || (timed && searched >= checked + clock_interval && expired()))
+		{
+			aborted = true;
+			return 0;
+		}
+
+		// order the moves by the mobility after them, with the best move of the previous search first,
+		// and take a move leaving the opponent without any legal move at once
+		int hint = entry.key == key ? entry.move : -1;
+		std::array<std::pair<int, int>, board::size_x * board::size_y> order;
+		int count = 0;
+		for (int i : moves)
+		{
+			board::undo u = state.make(i);
+			int replies = state.legal_moves(opp).count();
+			int mobility = int(state.legal_moves(turn).count()) - replies;
+			state.unmake(u);
+			if (!replies)
+			{
+				store(entry, key, win, i);
+				if (best)
+					*best = i;
+				return win;
+			}
+			order[count++] = std::make_pair(i == hint ? INT_MIN : -mobility, i);
+		}
+		std::sort(order.begin(), order.begin() + count);
+
+		int value = -win, move = order[0].second;
+		for (int k = 0; k < count && !aborted; k++)
+		{
+			int i = order[k].second;
+			board::undo u = state.make(i);
+			int v = -negamax(state, depth - 1, -beta, -std::max(alpha, value));
+			state.unmake(u);
+			if (v > value)
+			{
+				value = v;
+				move = i;
+			}
+			if (value >= beta)
+				break;
+		}
+		if (aborted && value < win)
+			value = 0; // unknown, since some of the moves were not searched
+		store(entry, key, value, move);
+		if (best)
+			*best = move;
+		return value;
+	}
+
+	/**
+	 * whether the deadline has passed, the clock is checked after every clock_interval nodes
+	 */
+	bool expired()
+	{
+		checked = searched;
+		return std::chrono::steady_clock::now() >= deadline;
+	}
+
+	/**
+	 * keep the result of a position, where a solved position is never replaced by an unsolved one
+	 */
+	void store(Entry &entry, uint64_t key, int value, int move)
+	{
+		int8_t solved = value >= win ? 1 : (value <= -win ? -1 : 0);
+		if (entry.key != key && entry.solved && !solved)
+			return;
+		entry.key = key;
+		entry.solved = solved;
+		entry.move = move;
+	}
+
+private:
+	static constexpr size_t clock_interval = 1024;
+	std::vector<Entry> entries;
+	size_t mask;
+	size_t searched = 0;
+	size_t limit = 0;
+	bool timed = false;
+	std::chrono::steady_clock::time_point deadline;
+	size_t checked = 0; // the nodes at the last check of the clock
+	int reached = 0;
+	bool aborted = false;
+};
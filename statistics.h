@@ -12,74 +12,76 @@
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "board.h"
 #include "action.h"
 #include "episode.h"
+#include "recorder.h"
+#include "archive.h"
+#include "book.h"
 
 class statistics {
 public:
 	/**
 	 * the total episodes to run
 	 * the block size of statistics
-	 * the limit of saving records
+	 * the limit of episodes kept in memory (at least the ongoing one), i.e., the last records for save()
 	 *
-	 * note that total >= limit >= block
+	 * the statistics are running aggregates of the finished episodes, and the finished episodes
+	 * are streamed to the recorder if any, so the memory does not grow with the total episodes
 	 */
 	statistics(size_t total, size_t block = 0, size_t limit = 0)
 		: total(total),
 		  block(block ? block : total),
-		  limit(limit ? limit : total),
-		  count(0) {}
+		  limit(limit ? limit : 1),
+		  count(0),
+		  pending(0),
+		  book(nullptr) {}
 
-public:
 	/**
-	 * show the statistics of last 'block' games
-	 *
-	 * the format is
-	 * 1000   win = 53.5%|46.5%, op = 74.451 (37.493|36.958), ops = 125762 (132018|135377)
-	 *
-	 * where (block = 1000 by default)
-	 *  '1000': current index (n), i.e., this line is the statistic of game 1 ~ 1000
-	 *  'win = 53.5%|46.5%': the win rate for black is 53.5%; for white is 46.5%
-	 *  'op = 74.451 (37.493|36.958)': the average move is 74.451
-	 *                                 the average move of black is 37.493
-	 *                                 the average move of white is 36.958
-	 *  'ops = 125762 (132018|135377)': the average speed is 125762
-	 *                                  the average speed of black is 132018
-	 *                                  the average speed of white is 135377
+	 * stream all the following finished (or loaded) episodes to the file, see recorder
 	 */
-	void show(size_t blk = 0) const {
-		size_t num = std::min(data.size(), blk ?: block);
-		size_t sop = 0, Bop = 0, Wop = 0;
-		time_t sdu = 0, Bdu = 0, Wdu = 0;
-		size_t BW = 0, WW = 0;
-		auto it = data.end();
-		for (size_t i = 0; i < num; i++) {
-			auto& ep = *(--it);
-			if (ep.step() % 2 == 1) BW++;
-			else                    WW++;
-			sop += ep.step();
-			Bop += ep.step(action::black::type);
-			Wop += ep.step(action::white::type);
-			sdu += ep.time();
-			Bdu += ep.time(action::black::type);
-			Wdu += ep.time(action::white::type);
-		}
+	void record(const std::string& path, bool append = false, size_t flush = 1, bool async = false, bool counters = false) {
+		writer.reset(new recorder(path, append, flush, async, counters));
+	}
 
-		std::cout << count << "\t";
-		std::cout << "win = " << (BW * 100.0 / num) << "%"
-		          <<      "|" << (WW * 100.0 / num) << "%, ";
-		std::cout << "op = "  << (sop * 1.0 / num)
-		          <<     " (" << (Bop * 1.0 / num)
-		          <<      "|" << (Wop * 1.0 / num) << "), ";
-		std::cout << "ops = " << (sop * 1000.0 / sdu)
-		          <<     " (" << (Bop * 1000.0 / Bdu)
-		          <<      "|" << (Wop * 1000.0 / Wdu) << ")";
-		std::cout << std::endl;
+	/**
+	 * write the finished episodes kept in memory to the recorder, e.g., the last 'limit' records at exit
+	 * for a recorder opened after the episodes, instead of streaming all of them
+	 */
+	void save() {
+		for (const episode& ep : data)
+			if (ep.time() >= 0 && writer) writer->write(ep);
+	}
+
+	/**
+	 * add all the following finished (or loaded) episodes to the opening book, see opening_book::builder
+	 */
+	void collect(opening_book::builder* builder) {
+		book = builder;
 	}
 
+public:
+	/**
+	 * show the statistics of last 'block' games, see show(const aggregate&) for the format
+	 */
+	void show() const {
+		show(last);
+	}
+
+	/**
+	 * show the statistics of all the finished games
+	 */
 	void summary() const {
-		show(data.size());
+		show(all);
 	}
 
 	bool is_finished() const {
@@ -91,14 +93,55 @@ public:
 	}
 
 	void open_episode(const std::string& flag = "") {
-		if (count++ >= limit) data.pop_front();
+		if (data.size() >= limit) data.pop_front();
+		count++;
 		data.emplace_back();
 		data.back().open_episode(flag);
 	}
 
 	void close_episode(const std::string& flag = "") {
 		data.back().close_episode(flag);
-		if (count % block == 0) show();
+		finish(data.back());
+	}
+
+	/**
+	 * reserve one of the remaining episodes for a parallel worker
+	 * return false if all the episodes are finished or reserved by other workers
+	 */
+	bool reserve_episode() {
+		std::lock_guard<std::mutex> guard(mutex);
+		if (count + pending >= total) return false;
+		pending++;
+		return true;
+	}
+
+	/**
+	 * give up a reserved episode, e.g., of a lost remote worker, so that it is reserved again by another worker
+	 */
+	void release_episode() {
+		std::lock_guard<std::mutex> guard(mutex);
+		pending--;
+	}
+
+	/**
+	 * whether all the episodes are merged, i.e., is_finished() while the parallel workers are running
+	 */
+	bool is_settled() {
+		std::lock_guard<std::mutex> guard(mutex);
+		return count >= total;
+	}
+
+	/**
+	 * merge a reserved episode which was played and closed by a parallel worker
+	 * the episodes are counted in the order they are finished, with the same block and limit as open_episode()
+	 */
+	void merge_episode(episode&& ep) {
+		std::lock_guard<std::mutex> guard(mutex);
+		pending--;
+		if (data.size() >= limit) data.pop_front();
+		count++;
+		data.push_back(std::move(ep));
+		finish(data.back());
 	}
 
 	episode& at(size_t i) {
@@ -120,18 +163,196 @@ public:
 	}
 	friend std::istream& operator >>(std::istream& in, statistics& stat) {
 		for (std::string line; std::getline(in, line) && line.size(); ) {
-			stat.data.emplace_back();
-			std::stringstream(line) >> stat.data.back();
+			episode ep;
+			std::stringstream(line) >> ep;
+			stat.load(std::move(ep));
 		}
-		stat.total = std::max(stat.total, stat.data.size());
-		stat.count = stat.data.size();
 		return in;
 	}
 
+	/**
+	 * load the records from a file of either the SGF text or the binary archive
+	 */
+	void load(const std::string& path) {
+		if (archive::is_archive(path)) {
+			archive::reader in(path);
+			for (size_t i = 0; i < in.size(); i++) load(in[i]);
+		} else {
+			load_text(path);
+		}
+	}
+
+private:
+	/**
+	 * the running sums of the episodes
+	 */
+	struct aggregate {
+		size_t games = 0, black_wins = 0, white_wins = 0;
+		size_t ops = 0, black_ops = 0, white_ops = 0;
+		time_t time = 0, black_time = 0, white_time = 0; // us
+		size_t searched = 0, iterations = 0, playouts = 0, nodes = 0, depth = 0, max_depth = 0, memory = 0;
+		time_t search_time = 0; // us, of the searched moves
+
+		void add(const episode& ep) {
+			games++;
+			if (ep.step() % 2 == 1) black_wins++;
+			else                    white_wins++;
+			ops += ep.step();
+			black_ops += ep.step(action::black::type);
+			white_ops += ep.step(action::white::type);
+			time += ep.time();
+			black_time += ep.time(action::black::type);
+			white_time += ep.time(action::white::type);
+			for (const episode::move& mv : ep.ep_moves) {
+				if (!mv.counters) continue;
+				searched++;
+				search_time += mv.time;
+				iterations += mv.counters.iterations;
+				playouts += mv.counters.playouts;
+				nodes += mv.counters.nodes;
+				depth += mv.counters.depth;
+				max_depth = std::max(max_depth, size_t(mv.counters.depth));
+				memory = std::max(memory, size_t(mv.counters.memory));
+			}
+		}
+	};
+
+	/**
+	 * show the statistics of the aggregated games
+	 *
+	 * the format is
+	 * 1000   win = 53.5%|46.5%, op = 74.451 (37.493|36.958), ops = 125762 (132018|135377)
+	 *
+	 * where (block = 1000 by default)
+	 *  '1000': current index (n), i.e., this line is the statistic of game 1 ~ 1000
+	 *  'win = 53.5%|46.5%': the win rate for black is 53.5%; for white is 46.5%
+	 *  'op = 74.451 (37.493|36.958)': the average move is 74.451
+	 *                                 the average move of black is 37.493
+	 *                                 the average move of white is 36.958
+	 *  'ops = 125762 (132018|135377)': the average speed is 125762
+	 *                                  the average speed of black is 132018
+	 *                                  the average speed of white is 135377
+	 *
+	 * and if some moves were searched, the averages of their searches follow, e.g.,
+	 * search = 1000 it, 3012 nodes, depth = 13.2 (25), playouts/s = 161234, mem = 1536K
+	 *  '1000 it, 3012 nodes': the average iterations and nodes in the trees per search
+	 *  'depth = 13.2 (25)': the average maximum depth of the searches is 13.2, and the deepest one is 25
+	 *  'playouts/s = 161234': the playouts per second of the thinking time of the searched moves
+	 *  'mem = 1536K': the largest memory (KiB) of the trees and the table
+	 */
+	void show(const aggregate& agg) const {
+		size_t num = agg.games;
+		std::cout << count << "\t";
+		std::cout << "win = " << (agg.black_wins * 100.0 / num) << "%"
+		          <<      "|" << (agg.white_wins * 100.0 / num) << "%, ";
+		std::cout << "op = "  << (agg.ops * 1.0 / num)
+		          <<     " (" << (agg.black_ops * 1.0 / num)
+		          <<      "|" << (agg.white_ops * 1.0 / num) << "), ";
+		std::cout << "ops = " << (agg.ops * 1000000.0 / agg.time)
+		          <<     " (" << (agg.black_ops * 1000000.0 / agg.black_time)
+		          <<      "|" << (agg.white_ops * 1000000.0 / agg.white_time) << ")";
+		if (agg.searched) {
+			size_t n = agg.searched;
+			std::cout << ", search = " << (agg.iterations / n) << " it, " << (agg.nodes / n) << " nodes, ";
+			std::cout << "depth = " << (agg.depth * 1.0 / n) << " (" << agg.max_depth << "), ";
+			std::cout << "playouts/s = " << size_t(agg.playouts * 1000000.0 / std::max(agg.search_time, time_t(1))) << ", ";
+			std::cout << "mem = " << (agg.memory >> 10) << "K";
+		}
+		std::cout << std::endl;
+	}
+
+	/**
+	 * load the lines of SGF text as operator >>, but from the file mapped into memory,
+	 * and with the lines of each chunk parsed in parallel by episode::parse()
+	 */
+	void load_text(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return; // as an empty stream
+		struct stat st;
+		size_t length = ::fstat(fd, &st) == 0 ? st.st_size : 0;
+		void* map = length ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		::close(fd);
+		if (map == MAP_FAILED) {
+			std::ifstream in(path, std::ios::in);
+			in >> *this;
+			return;
+		}
+		::madvise(map, length, MADV_SEQUENTIAL);
+		const char* it = static_cast<const char*>(map);
+		const char* end = it + length;
+
+		size_t threads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<std::pair<const char*, const char*>> lines;
+		std::vector<episode> chunk;
+		std::vector<std::thread> workers;
+		for (bool more = true; more; ) {
+			// split the next chunk on newlines, until an empty line as operator >>
+			lines.clear();
+			while (lines.size() < threads * 4096 && (more = it != end)) {
+				const char* eol = static_cast<const char*>(std::memchr(it, '\n', end - it));
+				if (!eol) eol = end;
+				if (eol == it) {
+					more = false;
+					break;
+				}
+				lines.emplace_back(it, eol);
+				it = eol != end ? eol + 1 : end;
+			}
+			chunk.resize(lines.size());
+			size_t share = (lines.size() + threads - 1) / threads;
+			for (size_t begin = share; begin < lines.size(); begin += share) {
+				workers.emplace_back([&, begin]() {
+					for (size_t i = begin; i < std::min(begin + share, lines.size()); i++)
+						chunk[i].parse(lines[i].first, lines[i].second);
+				});
+			}
+			for (size_t i = 0; i < std::min(share, lines.size()); i++)
+				chunk[i].parse(lines[i].first, lines[i].second);
+			for (std::thread& worker : workers) worker.join();
+			workers.clear();
+			for (episode& ep : chunk) load(std::move(ep));
+		}
+		::munmap(map, length);
+	}
+
+	/**
+	 * keep a loaded episode as a finished one, without showing the statistics
+	 * the loaded episodes of an unfinished block are shown together with the finished episodes of the block
+	 */
+	void load(episode&& ep) {
+		if (data.size() >= limit) data.pop_front();
+		data.push_back(std::move(ep));
+		all.add(data.back());
+		last.add(data.back());
+		if (writer) writer->write(data.back());
+		if (book) book->add(data.back().actions());
+		total = std::max(total, ++count);
+		if (block && count % block == 0) last = {};
+	}
+
+	/**
+	 * aggregate and stream a finished episode, and show the statistics at the end of each block
+	 */
+	void finish(const episode& ep) {
+		all.add(ep);
+		last.add(ep);
+		if (writer) writer->write(ep);
+		if (book) book->add(ep.actions());
+		if (count % block == 0) {
+			show();
+			last = {};
+		}
+	}
+
 private:
 	size_t total;
 	size_t block;
 	size_t limit;
 	size_t count;
+	size_t pending;
 	std::deque<episode> data;
+	std::mutex mutex;
+	aggregate all, last; // all the finished episodes, and the ones of the current block
+	std::unique_ptr<recorder> writer;
+	opening_book::builder* book;
 };
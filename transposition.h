@@ -0,0 +1,92 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * transposition.h: Define the transposition table shared by the searches
+ *
+ * Author: Theory of Computer Games
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * fixed-size table of the statistics of positions, keyed by the zobrist hash of the board
+ * the win count is of the side who just moved, i.e., the placer of the nodes reaching the position
+ *
+ * each bucket holds two entries next to each other, and a new key replaces the entry with fewer games
+ * all the accesses are relaxed atomics without locking, so a replacement racing with an update may
+ * occasionally mix the counters of two positions, which is tolerated as noise of the statistics
+ */
+class TranspositionTable
+{
+public:
+	struct Entry
+	{
+		std::atomic<uint64_t> key{0};
+		std::atomic<int> win{0}, games{0};
+	};
+
+	/**
+	 * a table of 2^bits entries, at least a single bucket of two entries
+	 */
+	TranspositionTable(int bits = 20) : entries(size_t(1) << std::max(bits, 1)), mask((size_t(1) << std::max(bits, 1)) - 1) {}
+
+	/**
+	 * find the entry of the key, or nullptr if the position is not in the table
+	 */
+	const Entry *probe(uint64_t key) const
+	{
+		key = key ? key : 1; // 0 marks an empty entry
+		const Entry *bucket = &entries[key & mask & ~size_t(1)];
+		if (bucket[0].key.load(std::memory_order_relaxed) == key)
+			return &bucket[0];
+		if (bucket[1].key.load(std::memory_order_relaxed) == key)
+			return &bucket[1];
+		return nullptr;
+	}
+
+	/**
+	 * find the entry of the key, or claim one for it, return nullptr if another thread took the entry
+	 */
+	Entry *insert(uint64_t key)
+	{
+		key = key ? key : 1;
+		Entry *bucket = &entries[key & mask & ~size_t(1)];
+		if (bucket[0].key.load(std::memory_order_relaxed) == key)
+			return &bucket[0];
+		if (bucket[1].key.load(std::memory_order_relaxed) == key)
+			return &bucket[1];
+		Entry *victim = bucket[0].games.load(std::memory_order_relaxed) <= bucket[1].games.load(std::memory_order_relaxed) ? &bucket[0] : &bucket[1];
+		uint64_t old = victim->key.load(std::memory_order_relaxed);
+		if (!victim->key.compare_exchange_strong(old, key, std::memory_order_relaxed))
+			return old == key ? victim : nullptr;
+		victim->win.store(0, std::memory_order_relaxed);
+		victim->games.store(0, std::memory_order_relaxed);
+		return victim;
+	}
+
+	void clear()
+	{
+		for (Entry &entry : entries)
+		{
+			entry.key.store(0, std::memory_order_relaxed);
+			entry.win.store(0, std::memory_order_relaxed);
+			entry.games.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	size_t size() const { return entries.size(); }
+
+	/**
+	 * the bytes of the entries
+	 */
+	size_t memory() const { return entries.size() * sizeof(Entry); }
+
+private:
+	std::vector<Entry> entries;
+	size_t mask;
+};